@@ -0,0 +1,84 @@
+#include "main.h"
+
+namespace ns3
+{
+
+    bool
+    AdSeenCache::Key::operator==(const Key& other) const
+    {
+        return origin_AS == other.origin_AS && name_hash == other.name_hash && cert_hash == other.cert_hash;
+    }
+
+    size_t
+    AdSeenCache::KeyHash::operator()(const Key& key) const
+    {
+        return key.name_hash ^ (key.cert_hash * 31) ^ ((uint64_t)key.origin_AS << 17);
+    }
+
+    AdSeenCache::AdSeenCache()
+    {
+        m_capacity = 0;
+    }
+
+    void
+    AdSeenCache::SetCapacity(uint32_t capacity)
+    {
+        m_capacity = capacity;
+        while (m_lru.size() > m_capacity){
+            m_index.erase(m_lru.back().first);
+            m_lru.pop_back();
+        }
+    }
+
+    uint32_t
+    AdSeenCache::GetCapacity() const
+    {
+        return m_capacity;
+    }
+
+    bool
+    AdSeenCache::IsDuplicate(const AdDigest& digest)
+    {
+        auto it = m_index.find(Key{digest.origin_AS, digest.name_hash, digest.cert_hash});
+        if (it == m_index.end()){
+            return false;
+        }
+        m_lru.splice(m_lru.begin(), m_lru, it->second);
+        return it->second->second <= digest.path_len;
+    }
+
+    void
+    AdSeenCache::Insert(const AdDigest& digest)
+    {
+        if (m_capacity == 0){
+            return;
+        }
+        Key key{digest.origin_AS, digest.name_hash, digest.cert_hash};
+        auto it = m_index.find(key);
+        if (it != m_index.end()){
+            it->second->second = std::min(it->second->second, digest.path_len);
+            m_lru.splice(m_lru.begin(), m_lru, it->second);
+            return;
+        }
+
+        m_lru.push_front(std::make_pair(key, digest.path_len));
+        m_index[key] = m_lru.begin();
+        if (m_lru.size() > m_capacity){
+            m_index.erase(m_lru.back().first);
+            m_lru.pop_back();
+        }
+    }
+
+    // An ad that was dropped locally (expired) is news again
+    void
+    AdSeenCache::Erase(const AdDigest& digest)
+    {
+        auto it = m_index.find(Key{digest.origin_AS, digest.name_hash, digest.cert_hash});
+        if (it == m_index.end()){
+            return;
+        }
+        m_lru.erase(it->second);
+        m_index.erase(it);
+    }
+
+}
@@ -2,38 +2,17 @@
 
 NameDBEntry::NameDBEntry(std::string& _dc_name,
                          Ipv4Address& _origin_AS_addr,
-                         std::string& _td_path,
+                         const TdPath& _td_path,
                          Ipv4Address& _origin_server,
                          TrustCert _trust_cert,
                          std::vector<DistrustCert> _distrust_certs)
 {
     dc_name = _dc_name;
     origin_AS_addr = _origin_AS_addr;
+    td_path = _td_path;
     origin_server = _origin_server;
     trust_cert = _trust_cert;
     distrust_certs = _distrust_certs;
-
-    // deserialize the td_path to vector
-    // td_path is in the form: A->B->C->D
-    // we want a vector containing {A, B, C, D}
-    // std::vector<Ipv4Address> td_path;
-    std::string segment = _td_path;
-    std::string delimiter = "->";
-    std::string td_to_add = segment.substr(0, segment.find(delimiter));
-    while (td_to_add.size() != 0)
-    {
-        td_path.push_back(Ipv4Address(td_to_add.c_str()));
-        if (td_to_add.size() + 2 < segment.size())
-        {
-            segment = segment.substr(td_to_add.size() + 2);
-        }
-        else
-        {
-            segment = segment.substr(segment.size());
-        }
-        td_to_add = segment.substr(0, segment.find(delimiter));
-    }
-    // std::cout << "size of deserialized td_path is: " << td_path.size() << std::endl;
 }
 
 NameDBEntry::~NameDBEntry()
@@ -41,8 +20,8 @@ NameDBEntry::~NameDBEntry()
     // std::cout << "NameDBEntry destructor called" << std::endl;
 }
 
-NameDBEntry*
-NameDBEntry::FromAdvertisementStr(std::string& serialized)
+NameDBEntryPtr
+NameDBEntry::FromAdvertisementStr(std::string& serialized, NameDBEntryPool& pool)
 {
     // * deserialize the advertisement packet
     Json::Value deserializeRoot;
@@ -53,7 +32,26 @@ NameDBEntry::FromAdvertisementStr(std::string& serialized)
         return nullptr;
     }
     std::string dc_name = deserializeRoot.get("dc_name", "empty").asString();
-    std::string td_path = deserializeRoot.get("td_path", "").asString();
+    std::string td_path_str = deserializeRoot.get("td_path", "").asString();
+
+    // td_path is in the form: A->B->C->D
+    // we want a path containing {A, B, C, D}
+    TdPath td_path;
+    std::string delimiter = "->";
+    size_t pos = 0;
+    while (pos < td_path_str.size())
+    {
+        size_t next = td_path_str.find(delimiter, pos);
+        if (next == std::string::npos)
+        {
+            next = td_path_str.size();
+        }
+        if (next > pos && !td_path.push_back(Ipv4Address(td_path_str.substr(pos, next - pos).c_str())))
+        {
+            return nullptr;
+        }
+        pos = next + delimiter.size();
+    }
     Ipv4Address origin_AS_addr =
         Ipv4Address(deserializeRoot.get("origin_AS", "123.123.123.123").asString().c_str());
     Ipv4Address origin_server =
@@ -92,7 +90,10 @@ NameDBEntry::FromAdvertisementStr(std::string& serialized)
         }
     }
 
-    auto* entry = new NameDBEntry(dc_name, origin_AS_addr, td_path, origin_server, trust_cert, distrust_certs);
+    NameDBEntryPtr entry = pool.Create(dc_name, origin_AS_addr, td_path, origin_server, trust_cert, distrust_certs);
+    entry->seq = deserializeRoot.get("seq", 0).asUInt();
+    entry->withdrawn = deserializeRoot.get("withdraw", false).asBool();
+    entry->ttl = deserializeRoot.get("ttl", 0).asUInt();
     return entry;
 }
 
@@ -140,8 +141,79 @@ NameDBEntry::ToAdvertisementStr()
     }
 
     serializeRoot["distrust_certs"] = d_certs;
+    serializeRoot["seq"] = seq;
+    if (ttl != 0) {
+        serializeRoot["ttl"] = ttl;
+    }
+    if (withdrawn) {
+        serializeRoot["withdraw"] = true;
+    }
     // serialize the packet
-    Json::StyledWriter writer;
+    Json::FastWriter writer;
     return writer.write(serializeRoot);
-    ;
+}
+
+NameDBEntryPtr
+NameDBEntry::FromAdvertisementHeader(const AdvertisementHeader& header, NameDBEntryPool& pool)
+{
+    if (!header.IsValid() || header.td_path.size() > TdPath::CAPACITY)
+    {
+        return nullptr;
+    }
+
+    std::string dc_name = header.dc_name;
+    Ipv4Address origin_AS_addr = header.origin_AS_addr;
+    Ipv4Address origin_server = header.origin_server;
+
+    TrustCert trust_cert{"", "", "", 0};
+    if (header.has_trust_cert)
+    {
+        trust_cert = TrustCert{"trust", header.trust_entity, header.trust_issuer, header.r_transitivity};
+    }
+
+    std::vector<DistrustCert> distrust_certs;
+    for (auto& d : header.distrust_certs)
+    {
+        distrust_certs.push_back(DistrustCert{"distrust", d.second, d.first});
+    }
+
+    TdPath td_path;
+    for (auto& addr : header.td_path)
+    {
+        td_path.push_back(addr);
+    }
+
+    NameDBEntryPtr entry = pool.Create(dc_name, origin_AS_addr, td_path, origin_server, trust_cert, distrust_certs);
+    entry->seq = header.seq;
+    entry->withdrawn = header.withdrawn;
+    entry->ttl = header.ttl;
+    return entry;
+}
+
+AdvertisementHeader
+NameDBEntry::ToAdvertisementHeader()
+{
+    AdvertisementHeader header;
+    header.dc_name = dc_name;
+    header.origin_AS_addr = origin_AS_addr;
+    header.origin_server = origin_server;
+    header.td_path.assign(td_path.begin(), td_path.end());
+
+    // same "empty cert" convention as the JSON encoding
+    header.has_trust_cert = !(trust_cert.issuer.empty() && trust_cert.entity.empty() && trust_cert.r_transitivity == 0);
+    if (header.has_trust_cert)
+    {
+        header.trust_issuer = trust_cert.issuer;
+        header.trust_entity = trust_cert.entity;
+        header.r_transitivity = trust_cert.r_transitivity;
+    }
+
+    for (auto& d : distrust_certs)
+    {
+        header.distrust_certs.push_back(std::make_pair(d.issuer, d.entity));
+    }
+    header.seq = seq;
+    header.withdrawn = withdrawn;
+    header.ttl = ttl;
+    return header;
 }
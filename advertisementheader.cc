@@ -0,0 +1,336 @@
+#include "main.h"
+
+namespace ns3
+{
+
+    NS_OBJECT_ENSURE_REGISTERED(AdvertisementHeader);
+
+    TypeId
+    AdvertisementHeader::GetTypeId()
+    {
+        static TypeId tid =
+            TypeId("ns3::AdvertisementHeader")
+                .SetParent<Header>()
+                .SetGroupName("Applications")
+                .AddConstructor<AdvertisementHeader>();
+        return tid;
+    }
+
+    TypeId
+    AdvertisementHeader::GetInstanceTypeId() const
+    {
+        return GetTypeId();
+    }
+
+    bool
+    AdvertisementHeader::IsValid() const
+    {
+        return m_valid;
+    }
+
+    static void
+    WriteString(Buffer::Iterator& i, const std::string& str)
+    {
+        i.WriteHtonU16(str.size());
+        i.Write((const uint8_t *)str.data(), str.size());
+    }
+
+    // Strings are read straight out of the packet buffer; false if the length runs past its end
+    static bool
+    ReadString(Buffer::Iterator& i, std::string& str)
+    {
+        if (i.GetRemainingSize() < 2){
+            return false;
+        }
+        uint16_t len = i.ReadNtohU16();
+        if (i.GetRemainingSize() < len){
+            return false;
+        }
+        str.resize(len);
+        i.Read((uint8_t *)&str[0], len);
+        return true;
+    }
+
+    static const uint8_t NAME_STRING = 0;
+    static const uint8_t NAME_ID = 1;
+
+    static const uint8_t FLAG_WITHDRAWN = 0x01;
+
+    static void
+    WriteName(Buffer::Iterator& i, const std::string& name)
+    {
+        uint8_t id[DCName::ID_SIZE];
+        if (DCName::ToBytes(name, id)){
+            i.WriteU8(NAME_ID);
+            i.Write(id, DCName::ID_SIZE);
+        }else{
+            i.WriteU8(NAME_STRING);
+            WriteString(i, name);
+        }
+    }
+
+    // Version 1 ads have no kind byte and always carry the name as a string
+    static bool
+    ReadName(Buffer::Iterator& i, uint8_t version, std::string& name)
+    {
+        if (version == 1){
+            return ReadString(i, name);
+        }
+        if (i.GetRemainingSize() < 1){
+            return false;
+        }
+        if (i.ReadU8() == NAME_STRING){
+            return ReadString(i, name);
+        }
+        if (i.GetRemainingSize() < DCName::ID_SIZE){
+            return false;
+        }
+        uint8_t id[DCName::ID_SIZE];
+        i.Read(id, DCName::ID_SIZE);
+        name = DCName::FromBytes(id);
+        return true;
+    }
+
+    static uint32_t
+    GetNameSize(const std::string& name)
+    {
+        return DCName::IsId(name) ? 1 + DCName::ID_SIZE : 1 + 2 + name.size();
+    }
+
+    uint32_t
+    AdvertisementHeader::GetSerializedSize() const
+    {
+        uint32_t size = 1 + 1 + 2 + 4 + 4 + 4 * td_path.size() + GetNameSize(dc_name) + 1;
+        if (has_trust_cert){
+            size += 2 + trust_issuer.size() + 2 + trust_entity.size() + 4;
+        }
+        size += 2;
+        for (auto& d : distrust_certs){
+            size += 2 + d.first.size() + 2 + d.second.size();
+        }
+        size += 1 + 4 + 4;
+        return size;
+    }
+
+    void
+    AdvertisementHeader::Serialize(Buffer::Iterator start) const
+    {
+        Buffer::Iterator i = start;
+        i.WriteU8(MAGIC);
+        i.WriteU8(VERSION);
+        i.WriteHtonU16(td_path.size());
+        i.WriteHtonU32(origin_AS_addr.Get());
+        i.WriteHtonU32(origin_server.Get());
+        for (auto& addr : td_path){
+            i.WriteHtonU32(addr.Get());
+        }
+        WriteName(i, dc_name);
+
+        i.WriteU8(has_trust_cert ? 1 : 0);
+        if (has_trust_cert){
+            WriteString(i, trust_issuer);
+            WriteString(i, trust_entity);
+            i.WriteHtonU32((uint32_t)r_transitivity);
+        }
+
+        i.WriteHtonU16(distrust_certs.size());
+        for (auto& d : distrust_certs){
+            WriteString(i, d.first);
+            WriteString(i, d.second);
+        }
+
+        i.WriteU8(withdrawn ? FLAG_WITHDRAWN : 0);
+        i.WriteHtonU32(seq);
+        i.WriteHtonU32(ttl);
+    }
+
+    uint32_t
+    AdvertisementHeader::Deserialize(Buffer::Iterator start)
+    {
+        Buffer::Iterator i = start;
+        m_valid = false;
+        td_path.clear();
+        distrust_certs.clear();
+        seq = 0;
+        withdrawn = false;
+        ttl = 0;
+
+        if (i.GetRemainingSize() < 12){
+            return 0;
+        }
+        if (i.ReadU8() != MAGIC){
+            return 0;
+        }
+        uint8_t version = i.ReadU8();
+        if (version < 1 || version > VERSION){
+            return 0;
+        }
+        uint16_t path_len = i.ReadNtohU16();
+        origin_AS_addr = Ipv4Address(i.ReadNtohU32());
+        origin_server = Ipv4Address(i.ReadNtohU32());
+
+        if (i.GetRemainingSize() < 4u * path_len){
+            return i.GetDistanceFrom(start);
+        }
+        td_path.reserve(path_len);
+        for (uint16_t k = 0; k < path_len; k++){
+            td_path.push_back(Ipv4Address(i.ReadNtohU32()));
+        }
+        if (!ReadName(i, version, dc_name) || i.GetRemainingSize() < 1){
+            return i.GetDistanceFrom(start);
+        }
+
+        has_trust_cert = i.ReadU8() != 0;
+        if (has_trust_cert){
+            if (!ReadString(i, trust_issuer) || !ReadString(i, trust_entity) || i.GetRemainingSize() < 4){
+                return i.GetDistanceFrom(start);
+            }
+            r_transitivity = (int32_t)i.ReadNtohU32();
+        }
+
+        if (i.GetRemainingSize() < 2){
+            return i.GetDistanceFrom(start);
+        }
+        uint16_t ndistrust = i.ReadNtohU16();
+        for (uint16_t k = 0; k < ndistrust; k++){
+            std::string issuer, entity;
+            if (!ReadString(i, issuer) || !ReadString(i, entity)){
+                return i.GetDistanceFrom(start);
+            }
+            distrust_certs.push_back(std::make_pair(issuer, entity));
+        }
+
+        // Version 3 adds flags and the origin's sequence number
+        if (version >= 3){
+            if (i.GetRemainingSize() < 5){
+                return i.GetDistanceFrom(start);
+            }
+            withdrawn = (i.ReadU8() & FLAG_WITHDRAWN) != 0;
+            seq = i.ReadNtohU32();
+        }
+        // Version 4 adds the TTL
+        if (version >= 4){
+            if (i.GetRemainingSize() < 4){
+                return i.GetDistanceFrom(start);
+            }
+            ttl = i.ReadNtohU32();
+        }
+
+        m_valid = true;
+        return i.GetDistanceFrom(start);
+    }
+
+    void
+    AdvertisementHeader::Print(std::ostream& os) const
+    {
+        os << "dc_name=" << dc_name << " origin_AS=" << origin_AS_addr
+           << " origin_server=" << origin_server << " td_path=";
+        for (auto& addr : td_path){
+            os << addr << ",";
+        }
+        if (has_trust_cert){
+            os << " trust=" << trust_issuer << "->" << trust_entity << "(" << r_transitivity << ")";
+        }
+        os << " distrusts=" << distrust_certs.size() << " seq=" << seq << " ttl=" << ttl;
+        if (withdrawn){
+            os << " withdrawn";
+        }
+    }
+
+
+    NS_OBJECT_ENSURE_REGISTERED(AdvertisementDigestHeader);
+
+    TypeId
+    AdvertisementDigestHeader::GetTypeId()
+    {
+        static TypeId tid =
+            TypeId("ns3::AdvertisementDigestHeader")
+                .SetParent<Header>()
+                .SetGroupName("Applications")
+                .AddConstructor<AdvertisementDigestHeader>();
+        return tid;
+    }
+
+    TypeId
+    AdvertisementDigestHeader::GetInstanceTypeId() const
+    {
+        return GetTypeId();
+    }
+
+    bool
+    AdvertisementDigestHeader::IsValid() const
+    {
+        return m_valid;
+    }
+
+    const AdDigest&
+    AdvertisementDigestHeader::GetDigest() const
+    {
+        return m_digest;
+    }
+
+    uint32_t
+    AdvertisementDigestHeader::GetSerializedSize() const
+    {
+        return m_size;
+    }
+
+    void
+    AdvertisementDigestHeader::Serialize(Buffer::Iterator /* start */) const
+    {
+        // Read-only view of an AdvertisementHeader, never added to a packet
+        NS_FATAL_ERROR("AdvertisementDigestHeader cannot be serialized");
+    }
+
+    uint32_t
+    AdvertisementDigestHeader::Deserialize(Buffer::Iterator start)
+    {
+        Buffer::Iterator i = start;
+        m_valid = false;
+        m_size = 0;
+
+        if (i.GetRemainingSize() < 12){
+            return 0;
+        }
+        if (i.ReadU8() != AdvertisementHeader::MAGIC){
+            return 0;
+        }
+        uint8_t version = i.ReadU8();
+        if (version < 1 || version > AdvertisementHeader::VERSION){
+            return 0;
+        }
+        m_digest.path_len = i.ReadNtohU16();
+        m_digest.origin_AS = i.ReadNtohU32();
+        i.Next(4); // origin server is implied by (origin AS, name)
+
+        if (i.GetRemainingSize() < 4u * m_digest.path_len + 1){
+            return 0;
+        }
+        i.Next(4 * m_digest.path_len);
+
+        std::string name;
+        if (!ReadName(i, version, name)){
+            return 0;
+        }
+        m_digest.name_hash = Hash64(name);
+
+        // Everything after the name is the cert section (and, since v3, flags, seq and TTL)
+        std::string certs(i.GetRemainingSize(), '\0');
+        if (!certs.empty()){
+            i.Read((uint8_t *)&certs[0], certs.size());
+        }
+        m_digest.cert_hash = Hash64(certs);
+
+        m_valid = true;
+        m_size = i.GetDistanceFrom(start);
+        return m_size;
+    }
+
+    void
+    AdvertisementDigestHeader::Print(std::ostream& os) const
+    {
+        os << "origin_AS=" << Ipv4Address(m_digest.origin_AS) << " name_hash=" << m_digest.name_hash
+           << " cert_hash=" << m_digest.cert_hash << " path_len=" << m_digest.path_len;
+    }
+
+}
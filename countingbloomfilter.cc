@@ -0,0 +1,138 @@
+#include "main.h"
+
+namespace ns3
+{
+
+    CountingBloomFilter::CountingBloomFilter()
+    {
+        m_hashes = 0;
+    }
+
+    void
+    CountingBloomFilter::Reset(uint32_t bits, uint32_t hashes)
+    {
+        m_counters.assign(bits, 0);
+        m_hashes = hashes;
+    }
+
+    // Double hashing: h1 + i * h2 over one 64-bit hash of the key
+    std::vector<uint32_t>
+    CountingBloomFilter::Indices(const std::string& key) const
+    {
+        std::vector<uint32_t> indices;
+        if (m_counters.empty()){
+            return indices;
+        }
+        uint64_t h = Hash64(key);
+        uint64_t h1 = h & 0xffffffff;
+        uint64_t h2 = (h >> 32) | 1;
+        for (uint32_t i = 0; i < m_hashes; i++){
+            indices.push_back((h1 + i * h2) % m_counters.size());
+        }
+        return indices;
+    }
+
+    std::vector<uint32_t>
+    CountingBloomFilter::Add(const std::string& key)
+    {
+        std::vector<uint32_t> flipped;
+        for (uint32_t index : Indices(key)){
+            if (m_counters[index] == 255){
+                continue;
+            }
+            if (m_counters[index]++ == 0){
+                flipped.push_back(index);
+            }
+        }
+        return flipped;
+    }
+
+    std::vector<uint32_t>
+    CountingBloomFilter::Remove(const std::string& key)
+    {
+        std::vector<uint32_t> flipped;
+        for (uint32_t index : Indices(key)){
+            if (m_counters[index] == 0 || m_counters[index] == 255){
+                continue;
+            }
+            if (--m_counters[index] == 0){
+                flipped.push_back(index);
+            }
+        }
+        return flipped;
+    }
+
+    bool
+    CountingBloomFilter::MayContain(const std::string& key) const
+    {
+        std::vector<uint32_t> indices = Indices(key);
+        if (indices.empty()){
+            return false;
+        }
+        for (uint32_t index : indices){
+            if (m_counters[index] == 0){
+                return false;
+            }
+        }
+        return true;
+    }
+
+    void
+    CountingBloomFilter::SetBit(uint32_t index, bool set)
+    {
+        if (index < m_counters.size()){
+            m_counters[index] = set ? 1 : 0;
+        }
+    }
+
+    uint32_t
+    CountingBloomFilter::GetBits() const
+    {
+        return m_counters.size();
+    }
+
+    uint32_t
+    CountingBloomFilter::GetHashes() const
+    {
+        return m_hashes;
+    }
+
+    // 4 bits per hex digit, bit 0 is the most significant bit of the first digit
+    std::string
+    CountingBloomFilter::ToHex() const
+    {
+        static const char digits[] = "0123456789abcdef";
+        std::string hex;
+        for (size_t i = 0; i < m_counters.size(); i += 4){
+            int nibble = 0;
+            for (size_t b = 0; b < 4 && i + b < m_counters.size(); b++){
+                if (m_counters[i + b] != 0){
+                    nibble |= 8 >> b;
+                }
+            }
+            hex.push_back(digits[nibble]);
+        }
+        return hex;
+    }
+
+    bool
+    CountingBloomFilter::FromHex(uint32_t bits, uint32_t hashes, const std::string& hex)
+    {
+        if (bits == 0 || hex.size() != (bits + 3) / 4){
+            return false;
+        }
+        std::vector<uint8_t> counters(bits, 0);
+        for (size_t i = 0; i < bits; i++){
+            char c = hex[i / 4];
+            int nibble = (c >= '0' && c <= '9') ? c - '0' : (c >= 'a' && c <= 'f') ? c - 'a' + 10 : -1;
+            if (nibble < 0){
+                return false;
+            }
+            counters[i] = (nibble & (8 >> (i % 4))) ? 1 : 0;
+        }
+        m_counters.swap(counters);
+        m_hashes = hashes;
+        return true;
+    }
+
+}
@@ -178,19 +178,16 @@ namespace ns3
                     path.pop_back();
                  
                 } else {
-                    NS_LOG_INFO("DCEchoServer GIVESWITCHES response: " << temp);
-
-                    std::istringstream iss(ss.str());
-
-                    while (iss){
-                        std::string addr_str = "0.0.0.0";
-                        iss >> addr_str;
-                        if (addr_str == "0.0.0.0"){
-                            break;
-                        }
+                    uint32_t version;
+                    bool not_modified;
+                    MemberList::Entries entries;
+                    if (!MemberList::Decode(temp, version, not_modified, entries)){
+                        continue;
+                    }
+                    NS_LOG_INFO("DCEchoServer GIVESWITCHES response, version " << version);
 
-                        Ipv4Address addr(addr_str.c_str());
-                        switches_in_my_td.insert(addr);
+                    for (auto& entry : entries){
+                        switches_in_my_td.insert(entry.first);
                     }
 
                     for (auto &addr: switches_in_my_td){
@@ -0,0 +1,175 @@
+#include "main.h"
+
+// FIPS 180-4 SHA-256, only used to derive DataCapsule IDs
+static const uint32_t SHA256_K[64] = {
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+    0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+    0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+    0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+    0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+    0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2};
+
+static inline uint32_t
+Rotr(uint32_t x, int n)
+{
+    return (x >> n) | (x << (32 - n));
+}
+
+static void
+Sha256Block(uint32_t* state, const uint8_t* block)
+{
+    uint32_t w[64];
+    for (int i = 0; i < 16; i++)
+    {
+        w[i] = (uint32_t)block[4 * i] << 24 | (uint32_t)block[4 * i + 1] << 16 |
+               (uint32_t)block[4 * i + 2] << 8 | (uint32_t)block[4 * i + 3];
+    }
+    for (int i = 16; i < 64; i++)
+    {
+        uint32_t s0 = Rotr(w[i - 15], 7) ^ Rotr(w[i - 15], 18) ^ (w[i - 15] >> 3);
+        uint32_t s1 = Rotr(w[i - 2], 17) ^ Rotr(w[i - 2], 19) ^ (w[i - 2] >> 10);
+        w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+    }
+
+    uint32_t a = state[0], b = state[1], c = state[2], d = state[3];
+    uint32_t e = state[4], f = state[5], g = state[6], h = state[7];
+    for (int i = 0; i < 64; i++)
+    {
+        uint32_t t1 = h + (Rotr(e, 6) ^ Rotr(e, 11) ^ Rotr(e, 25)) + ((e & f) ^ (~e & g)) + SHA256_K[i] + w[i];
+        uint32_t t2 = (Rotr(a, 2) ^ Rotr(a, 13) ^ Rotr(a, 22)) + ((a & b) ^ (a & c) ^ (b & c));
+        h = g;
+        g = f;
+        f = e;
+        e = d + t1;
+        d = c;
+        c = b;
+        b = a;
+        a = t1 + t2;
+    }
+    state[0] += a; state[1] += b; state[2] += c; state[3] += d;
+    state[4] += e; state[5] += f; state[6] += g; state[7] += h;
+}
+
+void
+DCName::Sha256(const uint8_t* data, size_t len, uint8_t* out)
+{
+    uint32_t state[8] = {0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a,
+                         0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19};
+    size_t i = 0;
+    for (; i + 64 <= len; i += 64)
+    {
+        Sha256Block(state, data + i);
+    }
+
+    // padding: 0x80, zeros, then the bit length in the last 8 bytes
+    uint8_t tail[128] = {0};
+    size_t rest = len - i;
+    memcpy(tail, data + i, rest);
+    tail[rest] = 0x80;
+    size_t tail_len = rest + 9 <= 64 ? 64 : 128;
+    uint64_t bits = (uint64_t)len * 8;
+    for (int k = 0; k < 8; k++)
+    {
+        tail[tail_len - 1 - k] = (uint8_t)(bits >> (8 * k));
+    }
+    Sha256Block(state, tail);
+    if (tail_len == 128)
+    {
+        Sha256Block(state, tail + 64);
+    }
+
+    for (int k = 0; k < 8; k++)
+    {
+        out[4 * k] = (uint8_t)(state[k] >> 24);
+        out[4 * k + 1] = (uint8_t)(state[k] >> 16);
+        out[4 * k + 2] = (uint8_t)(state[k] >> 8);
+        out[4 * k + 3] = (uint8_t)state[k];
+    }
+}
+
+std::string
+DCName::FromMetadata(const std::string& metadata)
+{
+    uint8_t digest[ID_SIZE];
+    Sha256((const uint8_t*)metadata.data(), metadata.size(), digest);
+    return FromBytes(digest);
+}
+
+std::string
+DCName::FromBytes(const uint8_t* bytes)
+{
+    static const char hex[] = "0123456789abcdef";
+    std::string id(2 * ID_SIZE, '0');
+    for (size_t i = 0; i < ID_SIZE; i++)
+    {
+        id[2 * i] = hex[bytes[i] >> 4];
+        id[2 * i + 1] = hex[bytes[i] & 0xf];
+    }
+    return id;
+}
+
+static int
+HexValue(char c)
+{
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    return -1;
+}
+
+bool
+DCName::IsId(const std::string& name)
+{
+    if (name.size() != 2 * ID_SIZE)
+    {
+        return false;
+    }
+    for (char c : name)
+    {
+        if (HexValue(c) < 0)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool
+DCName::ToBytes(const std::string& id, uint8_t* out)
+{
+    if (!IsId(id))
+    {
+        return false;
+    }
+    for (size_t i = 0; i < ID_SIZE; i++)
+    {
+        out[i] = (uint8_t)(HexValue(id[2 * i]) << 4 | HexValue(id[2 * i + 1]));
+    }
+    return true;
+}
+
+const std::string&
+DCNameTable::Intern(const std::string& id)
+{
+    return *ids.insert(id).first;
+}
+
+void
+DCNameTable::SetLabel(const std::string& id, const std::string& label)
+{
+    labels[id] = label;
+}
+
+std::string
+DCNameTable::GetLabel(const std::string& id) const
+{
+    auto it = labels.find(id);
+    return it == labels.end() ? id : it->second;
+}
+
+size_t
+DCNameTable::Size() const
+{
+    return ids.size();
+}
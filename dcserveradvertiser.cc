@@ -40,7 +40,19 @@ namespace ns3
                             "the size of the header carrying the sequence number and the time stamp.",
                             UintegerValue(1024),
                             MakeUintegerAccessor(&DCServerAdvertiser::m_size),
-                            MakeUintegerChecker<uint32_t>(12, 65507));
+                            MakeUintegerChecker<uint32_t>(12, 65507))
+                .AddAttribute("AdTtl",
+                            "TTL stamped into every ad this server sends, 0 for ads that never expire. "
+                            "Keep it at least 3 RefreshIntervals (AD_TTL_REFRESHES), unrefreshed ads expire",
+                            TimeValue(Seconds(0)),
+                            MakeTimeAccessor(&DCServerAdvertiser::m_adTtl),
+                            MakeTimeChecker())
+                .AddAttribute("RefreshInterval",
+                            "Time between refresh digests sent to the RIB once all ads went out, 0 for none. "
+                            "At most AdTtl / 3 (AD_TTL_REFRESHES)",
+                            TimeValue(Seconds(0)),
+                            MakeTimeAccessor(&DCServerAdvertiser::m_refreshInterval),
+                            MakeTimeChecker());
         return tid;
     }
 
@@ -172,6 +184,13 @@ namespace ns3
                 std::stringstream ss;
                 packet->CopyData(&ss, packet->GetSize());
                 NS_LOG_INFO("Peer Info received: " << ss.str());
+
+                // * the RIB lost (some of) our ads, send all of them again
+                if (ss.str() == "RESYNC" && sentNum == dcNameList.size()) {
+                    sentNum = 1;
+                    m_advertised.clear();
+                    m_sendEvent = Simulator::ScheduleNow(&DCServerAdvertiser::Send, this);
+                }
             }
         }
     }
@@ -181,6 +200,7 @@ namespace ns3
     {
         NS_LOG_FUNCTION(this);
         Simulator::Cancel(m_sendEvent);
+        Simulator::Cancel(m_refreshEvent);
     }
 
     void
@@ -196,7 +216,25 @@ namespace ns3
         seqTs.SetSeq(m_sent);
         Ptr<Packet> p = Create<Packet>(0); // 8+4 : the size of the seqTs header
         p->AddHeader(seqTs);
-        Ptr<Packet> __p = Create<Packet>((const uint8_t *)dcNameList[sentNum].c_str(), dcNameList[sentNum].size());
+        std::string content = dcNameList[sentNum];
+        if (!content.empty() && content[0] == '{') {
+            Json::Value root;
+            Json::Reader reader;
+            if (reader.parse(content, root)) {
+                std::string name = root.get("dc_name", "").asString();
+                if (root.get("withdraw", false).asBool()) {
+                    m_advertised.erase(name);
+                } else {
+                    m_advertised.insert(name);
+                }
+                if (!m_adTtl.IsZero()) {
+                    root["ttl"] = (Json::UInt)std::max<int64_t>(1, m_adTtl.GetSeconds());
+                    Json::FastWriter writer;
+                    content = writer.write(root);
+                }
+            }
+        }
+        Ptr<Packet> __p = Create<Packet>((const uint8_t *)content.c_str(), content.size());
         p->AddAtEnd(__p);
 
         if ((m_socket->Send(p)) >= 0)
@@ -220,6 +258,29 @@ namespace ns3
         {
             m_sendEvent = Simulator::Schedule(m_interval, &DCServerAdvertiser::Send, this);
         }
+        else if (!m_refreshInterval.IsZero() && !m_refreshEvent.IsRunning())
+        {
+            m_refreshEvent = Simulator::Schedule(m_refreshInterval, &DCServerAdvertiser::Refresh, this);
+        }
+    }
+
+    /* Instead of resending every ad before its TTL runs out, the server sends
+     * "REFRESH <count> <digest>", the number of names it advertises and the (hex)
+     * sum of their Hash64. The RIB answers "RESYNC" if that does not match. */
+    void
+    DCServerAdvertiser::Refresh()
+    {
+        NS_LOG_FUNCTION(this);
+        m_refreshEvent = Simulator::Schedule(m_refreshInterval, &DCServerAdvertiser::Refresh, this);
+
+        uint64_t digest = 0;
+        for (auto& name : m_advertised) {
+            digest += Hash64(name);
+        }
+        std::stringstream ss;
+        ss << "REFRESH " << m_advertised.size() << " " << std::hex << digest;
+        std::string str_repr = ss.str();
+        m_socket->Send(Create<Packet>((const uint8_t *)str_repr.c_str(), str_repr.size()));
     }
 
     uint64_t
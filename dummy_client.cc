@@ -53,6 +53,7 @@ namespace ns3
         m_totalTx = 0;
         m_socket = nullptr;
         m_sendEvent = EventId();
+        m_switchVersion = 0;
     }
 
     DummyClient::~DummyClient()
@@ -164,6 +165,10 @@ namespace ns3
     {
         NS_LOG_INFO("DummyClient:GetSwitch");
         std::string s = "GIVESWITCHES";
+        if (!switches_in_my_td.empty()){
+            // * Only ask for the list if it changed since ours
+            s += " " + std::to_string(m_switchVersion);
+        }
         Ptr<Packet> p = Create<Packet>((const uint8_t *)s.c_str(), s.size());
 
         if (m_socket){
@@ -181,19 +186,22 @@ namespace ns3
             if (p->GetSize() > 0){
                 std::stringstream ss;
                 p->CopyData(&ss, p->GetSize());
-                NS_LOG_INFO("Dummy Client GIVESWITCHES response: " << ss.str());
-
-                std::istringstream iss(ss.str());
+                if (ss.str().substr(0, 5) == "NACK:"){
+                    // * RIB is overloaded, the periodic query retries
+                    continue;
+                }
 
-                while (iss){
-                    std::string addr_str = "0.0.0.0";
-                    iss >> addr_str;
-                    if (addr_str == "0.0.0.0"){
-                        break;
+                bool not_modified;
+                MemberList::Entries entries;
+                if (!MemberList::Decode(ss.str(), m_switchVersion, not_modified, entries)){
+                    continue;
+                }
+                NS_LOG_INFO("Dummy Client GIVESWITCHES response, version " << m_switchVersion);
+                if (!not_modified){
+                    switches_in_my_td.clear();
+                    for (auto& entry : entries){
+                        switches_in_my_td.insert(entry.first);
                     }
-
-                    Ipv4Address addr(addr_str.c_str());
-                    switches_in_my_td.insert(addr);
                 }
 
                 for (auto &addr: switches_in_my_td){
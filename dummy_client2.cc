@@ -260,16 +260,13 @@ namespace ns3
 
         m_socket->SetRecvCallback(MakeCallback(&DummyClient2::HandleSwitch, this));
         m_socket->SetAllowBroadcast(true);
-        m_sendEvent = Simulator::Schedule(Seconds(0.1), &DummyClient2::GetSwitch, this); // * first fetch local TD's live switches
+        m_subscribeEvent = Simulator::Schedule(Seconds(0.1), &DummyClient2::GetSwitch, this); // * subscribe to local TD's live switches
         
         if (!path_computer_socket){
             TypeId tid = TypeId::LookupByName("ns3::UdpSocketFactory");
             path_computer_socket = Socket::CreateSocket(GetNode(), tid);
+            // * Not connected, replies come from whichever shard owns the dc name
             path_computer_socket->Bind();
-
-            path_computer_socket->Connect(
-                InetSocketAddress(Ipv4Address::ConvertFrom(m_peerAddress), RIBPATHCOMPUTER_PORT));
-
         }
         path_computer_socket->SetRecvCallback(MakeCallback(&DummyClient2::HandleSwitch, this));
 
@@ -324,16 +321,49 @@ namespace ns3
         cert_socket->Close();
 
     }
+    // Subscribes to the live switches of our RIB, then renews the subscription.
+    // The RIB pushes membership changes, no polling.
     void
     DummyClient2::GetSwitch()
     {
         NS_LOG_INFO("DummyClient2:GetSwitch");
-        std::string s = "GIVESWITCHES";
-        Ptr<Packet> p = Create<Packet>((const uint8_t *)s.c_str(), s.size());
+        if (!switch_sub_socket){
+            TypeId tid = TypeId::LookupByName("ns3::UdpSocketFactory");
+            switch_sub_socket = Socket::CreateSocket(GetNode(), tid);
+            switch_sub_socket->Connect(
+                InetSocketAddress(Ipv4Address::ConvertFrom(m_peerAddress), RIBLSM_PORT));
+            switch_sub_socket->SetRecvCallback(MakeCallback(&DummyClient2::HandleSwitch, this));
+        }
+
+        std::string s = m_switchView.SubscribeRequest();
+        switch_sub_socket->Send(Create<Packet>((const uint8_t *)s.c_str(), s.size()));
+        m_subscribeEvent = Simulator::Schedule(Seconds(SWITCH_SUB_RENEW_SECONDS), &DummyClient2::GetSwitch, this);
+    }
 
-        if (m_socket){
-            m_socket->Send(p);   
+    void
+    DummyClient2::HandleMembership(const std::string& msg)
+    {
+        std::vector<Ipv4Address> added;
+        std::vector<Ipv4Address> removed;
+        if (!m_switchView.Apply(msg, added, removed)){
+            NS_LOG_INFO("Missed a switch membership delta, subscribing again");
+            std::string s = m_switchView.SubscribeRequest();
+            switch_sub_socket->Send(Create<Packet>((const uint8_t *)s.c_str(), s.size()));
+            return;
+        }
+
+        for (auto &addr: removed){
+            switches_in_my_td.erase(addr);
+            if (m_nearestOverlaySwitchInMyDomain.has_value() && m_nearestOverlaySwitchInMyDomain->first == addr){
+                m_nearestOverlaySwitchInMyDomain.reset();
+            }
         }
+        // Measure the RTT and pick the nearest one when sending next time
+        for (auto &addr: added){
+            switches_in_my_td.insert(addr);
+            SimpliEchoRequest(addr);
+        }
+        NS_LOG_INFO(m_name << " knows " << switches_in_my_td.size() << " switches at version " << m_switchView.GetVersion());
     }
 
     void
@@ -346,22 +376,24 @@ namespace ns3
             // client_name:xxxxxxx
             // dc_name:mmmmmmm 
         //}
-        std::string s = "GIVEPATH";
-        std::set<std::string>& namesToAsk = this->dcnames_to_route;
+        for (auto& n : this->dcnames_to_route) {
+            RequestPath(n);
+        }
+    }
+
+    void
+    DummyClient2::RequestPath(const std::string& dc_name)
+    {
         Json::Value request;
         request["client_name"] = m_name;
-        // request["dc_name"] = "";
-        for (auto& n : namesToAsk) {
-            // Packet Format is "GIVEADS [dc name]"
-            request["dc_name"] = n;
-            std::string res = s + " " + request.toStyledString();
-            Ptr<Packet> p = Create<Packet>((const uint8_t *)res.c_str(), res.size());
-
-            
-            if (path_computer_socket){
-                NS_LOG_INFO("sending through get path socket");
-                path_computer_socket->Send(p);   
-            }
+        request["dc_name"] = dc_name;
+        std::string res = "GIVEPATH " + request.toStyledString();
+        Ptr<Packet> p = Create<Packet>((const uint8_t *)res.c_str(), res.size());
+
+        Address rib = rib_shards.Size() > 0 ? rib_shards.Owner(dc_name) : m_peerAddress;
+        if (path_computer_socket){
+            NS_LOG_INFO("sending through get path socket");
+            path_computer_socket->SendTo(p, 0, InetSocketAddress(Ipv4Address::ConvertFrom(rib), RIBPATHCOMPUTER_PORT));
         }
     }
 
@@ -407,6 +439,37 @@ namespace ns3
                 p->CopyData(&ss, p->GetSize());
                 std::string temp = ss.str();
 
+                if (temp.substr(0, 5) == "NACK:") {
+                    // * RIB shed the request because it is overloaded
+                    NS_LOG_INFO("RIB shed request: " << temp);
+                    continue;
+                }
+
+                if (SwitchMembership::IsPush(temp)) {
+                    HandleMembership(temp);
+                    continue;
+                }
+
+                if (temp.substr(0, 10) == "pathinval:") {
+                    // * RIB revoked a path we were given. Format: "pathinval:<dc server ip> <dc name>"
+                    std::string body = temp.substr(10);
+                    auto pos = body.find(" ");
+                    if (pos == std::string::npos) {
+                        continue;
+                    }
+                    std::string origin_server = body.substr(0, pos);
+                    std::string dc_name = body.substr(pos + 1);
+                    NS_LOG_INFO("Path to " << origin_server << " invalidated by RIB, asking for a new one");
+
+                    auto it = m_pathSendEvents.find(origin_server);
+                    if (it != m_pathSendEvents.end()) {
+                        Simulator::Cancel(it->second);
+                        m_pathSendEvents.erase(it);
+                    }
+                    RequestPath(dc_name);
+                    continue;
+                }
+
                 // todo: change advertisement process into path response processing
                 if (temp.find("path:") != std::string::npos) {
                     NS_LOG_INFO("Dummy Client2 GIVEPATH response: " << temp);
@@ -433,6 +496,10 @@ namespace ns3
                     }
 
 
+                    if (switches_in_my_td.empty()) {
+                        NS_LOG_INFO("No live switch in my TD to send over");
+                        continue;
+                    }
                     Ipv4Address chosen = *(switches_in_my_td.begin());      //NOTE - This is the default oswitch to send packet to in case no distance probing has taken place
                     // Update target overlay switch to send packet to if there is a nearer one by knowledge of probing
                     if (m_nearestOverlaySwitchInMyDomain.has_value()) {
@@ -453,28 +520,14 @@ namespace ns3
                     std::string origin_server = path[path.size()-1];
                     NS_LOG_INFO("origin_server is: " << origin_server);
                     path.pop_back();
-                    Simulator::ScheduleNow(&DummyClient2::SendUsingPath, this, path, origin_server);
-
-                } else {
-                    NS_LOG_INFO("Dummy Client2 GIVESWITCHES response: " << temp);
-
-                    std::istringstream iss(ss.str());
-
-                    while (iss){
-                        std::string addr_str = "0.0.0.0";
-                        iss >> addr_str;
-                        if (addr_str == "0.0.0.0"){
-                            break;
-                        }
-
-                        Ipv4Address addr(addr_str.c_str());
-                        switches_in_my_td.insert(addr);
+                    auto it = m_pathSendEvents.find(origin_server);
+                    if (it != m_pathSendEvents.end()) {
+                        Simulator::Cancel(it->second);      // new path replaces the old one
                     }
+                    m_pathSendEvents[origin_server] = Simulator::ScheduleNow(&DummyClient2::SendUsingPath, this, path, origin_server);
 
-                    // Measure the RTT and pick the nearest one when sending next time
-                    for (auto &addr: switches_in_my_td){
-                        SimpliEchoRequest(addr);
-                    }
+                } else {
+                    NS_LOG_INFO("Dummy Client2 unexpected response: " << temp);
                 }
 
                 
@@ -489,6 +542,10 @@ namespace ns3
     {
         NS_LOG_FUNCTION(this);
         Simulator::Cancel(m_sendEvent);
+        Simulator::Cancel(m_subscribeEvent);
+        for (auto &x: m_pathSendEvents){
+            Simulator::Cancel(x.second);
+        }
     }
 
     void
@@ -565,7 +622,7 @@ namespace ns3
     #endif // NS3_LOG_ENABLE
 
         // m_sendEvent = Simulator::Schedule(m_interval, &DummyClient::Send, this);
-        Simulator::Schedule(Seconds(0.001), &DummyClient2::SendUsingPath, this, path, destination_ip);
+        m_pathSendEvents[destination_ip] = Simulator::Schedule(Seconds(0.001), &DummyClient2::SendUsingPath, this, path, destination_ip);
         
     }
 
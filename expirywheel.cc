@@ -0,0 +1,71 @@
+#include "main.h"
+
+namespace ns3
+{
+
+    ExpiryWheel::ExpiryWheel()
+    {
+        m_current = 0;
+        m_currentTick = 0;
+        m_count = 0;
+    }
+
+    void
+    ExpiryWheel::Configure(Time granularity, uint32_t slots)
+    {
+        m_granularity = granularity;
+        m_slots.assign(slots, std::vector<Key>());
+        m_current = 0;
+        m_currentTick = Simulator::Now().GetTimeStep() / granularity.GetTimeStep();
+        m_filed.clear();
+        m_count = 0;
+    }
+
+    Time
+    ExpiryWheel::GetGranularity() const
+    {
+        return m_granularity;
+    }
+
+    // Keys further out than one turn of the wheel land in the last slot and are refiled from there.
+    // A key already filed stays where it is; the caller refiles it when it comes due.
+    void
+    ExpiryWheel::Schedule(const Key& key, Time when)
+    {
+        if (!m_filed.insert(key).second){
+            return;
+        }
+        int64_t step = m_granularity.GetTimeStep();
+        int64_t tick = (when.GetTimeStep() + step - 1) / step;
+        int64_t delta = std::max<int64_t>(1, tick - m_currentTick);
+        delta = std::min<int64_t>(delta, m_slots.size() - 1);
+        m_slots[(m_current + delta) % m_slots.size()].push_back(key);
+        m_count++;
+    }
+
+    std::vector<ExpiryWheel::Key>
+    ExpiryWheel::Advance(Time now)
+    {
+        std::vector<Key> due;
+        int64_t target = now.GetTimeStep() / m_granularity.GetTimeStep();
+        while (m_currentTick < target){
+            m_currentTick++;
+            m_current = (m_current + 1) % m_slots.size();
+            std::vector<Key>& slot = m_slots[m_current];
+            m_count -= slot.size();
+            for (auto& key : slot){
+                m_filed.erase(key);
+            }
+            due.insert(due.end(), slot.begin(), slot.end());
+            slot.clear();
+        }
+        return due;
+    }
+
+    size_t
+    ExpiryWheel::Size() const
+    {
+        return m_count;
+    }
+
+}
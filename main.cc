@@ -27,7 +27,8 @@ name##Interfaces = address.Assign(p2p##name##Devices);
 
 #define BUILD_CLIENT(id, name, factory, appContainer)    {\
 Ptr<DummyClient2> dummyClient2 = factory.Create<DummyClient2>();\
-dummyClient2->SetRemote(ribs.first[(id)]->my_addr, RIBADSTORE_PORT);\
+dummyClient2->SetRemote(ribs.first[(id)]->shards.Owner(name), RIBADSTORE_PORT);\
+dummyClient2->rib_shards = ribs.first[(id)]->shards;\
 dummyClient2->SetAttribute("MaxPackets", UintegerValue(100));\
 dummyClient2->SetAttribute("Interval", TimeValue(Seconds(1.)));\
 dummyClient2->SetAttribute("PacketSize", UintegerValue(1024));\
@@ -56,7 +57,8 @@ randomNodeAssignment(
     BriteTopologyHelper& bth,
     InternetStackHelper& stack,
     Ipv4AddressHelper& address,                                 // SetBase before calling this function
-    double load_ratio)                                          // load_ratio = #new nodes / #leaf nodes in AS; load_ratio = 0 => 1 node per AS
+    double load_ratio,                                          // load_ratio = #new nodes / #leaf nodes in AS; load_ratio = 0 => 1 node per AS
+    uint32_t min_nodes = 1)                                     // at least this many nodes per AS
 {
     NS_LOG_INFO("Random P2P node Init");
     std::vector<std::pair<NodeContainer, Ipv4InterfaceContainer>> assgn;
@@ -68,11 +70,12 @@ randomNodeAssignment(
     for (uint32_t i = 0; i < nas; i++){
         uint32_t nleaf = bth.GetNNodesForAs(i);
         uint32_t nserver = (uint32_t)(load_ratio * nleaf);
-        if (nserver == 0) nserver++;
+        if (nserver < min_nodes) nserver = min_nodes;
 
         NS_LOG_INFO("AS: " << i << " Nodes: " << nleaf << " Nodes to create: " << nserver);
         std::default_random_engine eng;
-        std::uniform_int_distribution<uint32_t> dist(0, nserver - 1);
+        // attach to one of the AS's routers
+        std::uniform_int_distribution<uint32_t> dist(0, std::min(nserver, nleaf) - 1);
 
         NodeContainer servers;
         Ipv4InterfaceContainer interfaces;
@@ -185,6 +188,8 @@ std::string gen_random(const int len) {
     return tmp_s;
 }
 
+// Every server node of an AS runs a RIB shard, the first one is the primary; the
+// returned RIBs are the primaries
 std::pair<std::vector<RIB *>, ApplicationContainer>
 installRIBs(
     std::vector<std::pair<NodeContainer, Ipv4InterfaceContainer>>& serverAssgn,
@@ -195,11 +200,40 @@ installRIBs(
 
     for (size_t i = 0; i < serverAssgn.size(); i++){
         auto &x = serverAssgn[i];
-        RIB *rib = new RIB(i, x.second.GetAddress(0), addr_map);
-        apps.Add(rib->Install(x.first.Get(0)));
+        RIBShardRing shards;
+        for (uint32_t s = 0; s < x.first.GetN(); s++){
+            shards.AddShard(x.second.GetAddress(s));
+        }
+
+        RIB *rib = nullptr;
+        for (uint32_t s = 0; s < x.first.GetN(); s++){
+            RIB *shard = new RIB(i, x.second.GetAddress(s), addr_map);
+            apps.Add(shard->Install(x.first.Get(s)));
+            // fixed RNG streams so ad propagation jitter is reproducible across runs
+            shard->adStore->AssignStreams(100 + i + s * serverAssgn.size());
+            shard->shards = shards;
+            if (rib){
+                shard->primary = rib;
+                rib->replicas.push_back(shard);
+            }else{
+                rib = shard;
+            }
+        }
         ribs.push_back(rib);
     }
 
+    apps.Start(start);
+    apps.Stop(stop);
+
+    auto ret = std::make_pair(ribs, apps);
+
+    return ret;
+}
+
+// Traceroute from every RIB to every other one finds the RIB peerings, one destination per second
+void
+installTraceRoutes(std::vector<RIB *>& ribs, Time start, std::map<std::string, int> *addr_map)
+{
     std::vector<Address> rib_addrs;
     for (auto &y: ribs){
         rib_addrs.push_back(y->my_addr);
@@ -209,6 +243,9 @@ installRIBs(
         Time __gap = Seconds(0);
         Time __duration = Seconds(1);
         ApplicationContainer __app = y->InstallTraceRoute(rib_addrs, addr_map);
+        for (auto &replica: y->replicas){
+            replica->rib_addr_map_ = y->rib_addr_map_;
+        }
         for (uint32_t i = 0; i < __app.GetN(); i++){
             ApplicationContainer a;
             a.Add(__app.Get(i));
@@ -218,31 +255,27 @@ installRIBs(
         }
         // apps.Add(__app);
     }
-
-    apps.Start(start);
-    apps.Stop(stop);
-
-    auto ret = std::make_pair(ribs, apps);
-
-    return ret;
 }
 
 std::pair<std::vector<OverlaySwitch *>, ApplicationContainer>
 installSwitches(
     std::vector<std::pair<NodeContainer, Ipv4InterfaceContainer>>& switchAssgn,
-    std::vector<std::pair<NodeContainer, Ipv4InterfaceContainer>>& serverAssgn,
+    std::vector<RIB *>& ribs,
     Time start, Time stop)
 {
     std::vector<OverlaySwitch *> oswitches;
     ApplicationContainer apps;
 
-    uint32_t nas = serverAssgn.size();
+    uint32_t nas = ribs.size();
 
     for (uint32_t i = 0; i < nas; i++){
         for (uint32_t j = 0; j < switchAssgn[i].second.GetN(); j++){
+            // a switch heartbeats the RIB shard owning its address
+            std::stringstream ss;
+            ss << switchAssgn[i].second.GetAddress(j);
             OverlaySwitch *oswitch = new OverlaySwitch(
                 i, switchAssgn[i].second.GetAddress(j),
-                serverAssgn[i].second.GetAddress(0), Seconds(15.0));
+                ribs[i]->shards.Owner(ss.str()), Seconds(15.0));
             ApplicationContainer oswitchApps(oswitch->Install(switchAssgn[i].first.Get(j)));
 
             oswitches.push_back(oswitch);
@@ -282,6 +315,24 @@ void CreateAndEnqueueAds(const DCServer& dc_server, const std::string& dc_name)
     
 }
 
+// The DC server stops serving dc_name: its RIB floods a withdrawal of the ad
+void CreateAndEnqueueWithdrawal(const DCServer& dc_server, const std::string& dc_name) {
+    Json::Value serializeRoot;
+    serializeRoot["dc_name"] = dc_name;
+
+    std::stringstream ss;
+    Ipv4Address::ConvertFrom(dc_server.rib_addr).Print(ss);
+    serializeRoot["origin_AS"] = ss.str();
+
+    std::stringstream ss2;
+    Ipv4Address::ConvertFrom(dc_server.my_addr).Print(ss2);
+    serializeRoot["origin_server"] = ss2.str();
+    serializeRoot["withdraw"] = true;
+
+    Json::StyledWriter writer;
+    dc_server.advertiser->dcNameList.push_back(writer.write(serializeRoot));
+}
+
 void CreateAndEnqueueCert(const DCServer& dc_server, const std::string& dc_name, Ptr<DCOwner> dc_owner) {
     Ipv4Address origin_server_addr = Ipv4Address::ConvertFrom(dc_server.my_addr);
     std::stringstream ss;
@@ -320,14 +371,64 @@ main(int argc, char* argv[])
     std::string confFile = "scratch/trustnet/brite-conf.conf";
     bool tracing = false;
     bool nix = true;
+    uint32_t ribCores = 1;
+    uint32_t ribMaxQueue = 0;
+    bool withdrawLast = false;
+    bool summaryMode = false;
+    bool aggregateAds = false;
+    std::string dissemination = "Flood";
+    uint32_t gossipFanout = 3;
+    std::string snapshotSave = "";
+    std::string snapshotLoad = "";
+    double adTtl = 0;
+    double refreshInterval = 0;
+    uint32_t ribShards = 1;
+    double heartbeatTimeout = 3;
+    double sweepInterval = 0.5;
+    double heartbeatMaxInterval = 8;
 
     CommandLine cmd(__FILE__);
     cmd.AddValue("confFile", "BRITE conf file", confFile);
     cmd.AddValue("tracing", "Enable or disable ascii tracing", tracing);
     cmd.AddValue("nix", "Enable or disable nix-vector routing", nix);
+    cmd.AddValue("ribCores", "Requests each RIB serves concurrently", ribCores);
+    cmd.AddValue("ribMaxQueue", "RIB request queue depth before client queries are shed (0 = unbounded)", ribMaxQueue);
+    cmd.AddValue("heartbeatTimeout", "Seconds without a heartbeat before a RIB drops a switch", heartbeatTimeout);
+    cmd.AddValue("heartbeatMaxInterval", "Seconds switch heartbeats back off to while their RIB keeps them live", heartbeatMaxInterval);
+    cmd.AddValue("sweepInterval", "Seconds between the RIB's sweeps for timed-out switches", sweepInterval);
+    cmd.AddValue("ribShards", "RIB replicas per TD, splitting the name space by consistent hashing", ribShards);
+    cmd.AddValue("dissemination", "How RIBs pass ads on: Flood or Gossip", dissemination);
+    cmd.AddValue("gossipFanout", "Peers each updated ad is pushed to in gossip mode", gossipFanout);
+    cmd.AddValue("aggregateAds", "Each DC server advertises one ad for its owner's prefix instead of one per name", aggregateAds);
+    cmd.AddValue("summaryMode", "RIBs flood Bloom summaries of names and fetch ads on demand", summaryMode);
+    cmd.AddValue("adTtl", "TTL in seconds of every ad (0 = never expires), at least 3 refresh intervals", adTtl);
+    cmd.AddValue("refreshInterval", "Seconds between DC server refresh digests (0 = adTtl / 3, none without a TTL)", refreshInterval);
+    cmd.AddValue("snapshotSave", "Save the converged RIB state to this file when the clients start", snapshotSave);
+    cmd.AddValue("snapshotLoad", "Warm-start the RIBs from a snapshot saved with the same topology and seed", snapshotLoad);
+    cmd.AddValue("withdrawLast", "DC server 3 withdraws its last name after advertising all of them", withdrawLast);
 
     cmd.Parse(argc, argv);
 
+    // * Ads with a TTL vanish unless refreshed well within it
+    if (adTtl > 0 && refreshInterval == 0) {
+        refreshInterval = adTtl / AD_TTL_REFRESHES;
+    }
+    if (adTtl > 0 && adTtl < refreshInterval * AD_TTL_REFRESHES) {
+        NS_FATAL_ERROR("--adTtl must be at least " << AD_TTL_REFRESHES << " times --refreshInterval");
+    }
+
+    // * Per-opcode costs are set with --ns3::RIBServiceQueue::<Opcode>Cost=...
+    Config::SetDefault("ns3::RIBServiceQueue::Cores", UintegerValue(ribCores));
+    Config::SetDefault("ns3::RIBServiceQueue::MaxQueueDepth", UintegerValue(ribMaxQueue));
+    Config::SetDefault("ns3::RIBAdStore::SummaryMode", BooleanValue(summaryMode));
+    Config::SetDefault("ns3::RIBAdStore::DisseminationMode", StringValue(dissemination));
+    Config::SetDefault("ns3::RIBAdStore::GossipFanout", UintegerValue(gossipFanout));
+    Config::SetDefault("ns3::DCServerAdvertiser::AdTtl", TimeValue(Seconds(adTtl)));
+    Config::SetDefault("ns3::RIBLinkStateManger::HeartbeatTimeout", TimeValue(Seconds(heartbeatTimeout)));
+    Config::SetDefault("ns3::RIBLinkStateManger::SweepInterval", TimeValue(Seconds(sweepInterval)));
+    Config::SetDefault("ns3::OverlaySwitchPingClient::MaxInterval", TimeValue(Seconds(heartbeatMaxInterval)));
+    Config::SetDefault("ns3::DCServerAdvertiser::RefreshInterval", TimeValue(Seconds(refreshInterval)));
+
     // Invoke the BriteTopologyHelper and pass in a BRITE
     // configuration file and a seed file. This will use
     // BRITE to build a graph from which we can build the ns-3 topology
@@ -374,9 +475,9 @@ main(int argc, char* argv[])
     BUILD_P2P(dcOwner3, 3, "11.6.0.0")
 
 
-    address.SetBase(SERVER_SUBNET, COMMON_MASK); // * 1 server per AS
+    address.SetBase(SERVER_SUBNET, COMMON_MASK); // * 1 server per RIB shard
     auto serverAssgn = randomNodeAssignment(
-        bth, stack, address, 0
+        bth, stack, address, 0, ribShards
     );
 
 
@@ -384,6 +485,15 @@ main(int argc, char* argv[])
     // assignRandomASPeers(ribs.first);
     auto ribs = installRIBs(serverAssgn, Seconds(1.0), Seconds(GLOBAL_STOP_TIME), &addr_map);
 
+    // * A snapshot only fits the run that made it: same BRITE conf, same seed and run number
+    std::stringstream topologyKey;
+    topologyKey << confFile << " " << RngSeedManager::GetSeed() << " " << RngSeedManager::GetRun() << " " << ribs.first.size() << " " << ribShards;
+    uint64_t topology = Hash64(topologyKey.str());
+    bool warmStart = !snapshotLoad.empty() && LoadRIBSnapshot(snapshotLoad, ribs.first, topology);
+    if (!warmStart){
+        installTraceRoutes(ribs.first, Seconds(1.0), &addr_map);
+    }
+
     for (uint32_t i = 0; i < bth.GetNAs(); i++){
         for (uint32_t j = 0; j < bth.GetNLeafNodesForAs(i); j++){
             Ptr<Node> node = bth.GetLeafNodeForAs(i, j);
@@ -453,11 +563,20 @@ main(int argc, char* argv[])
 
     // SECTION - Preparing advertisement and certificates to all DataCapsule servers
     std::set<std::string> generated_names;
+    std::string random_dc_name;
     for (int i = 0; i < 10; i++){
-        // generate new dc names
-        std::string random_dc_name = gen_random(256);
+        // generate new dc names: the ID is the SHA-256 of the capsule metadata
+        random_dc_name = DCName::FromMetadata(gen_random(256));
         generated_names.insert(random_dc_name);
+        NS_LOG_INFO("DataCapsule capsule" << i << " ID: " << random_dc_name);
+        for (int r = 1; r <= 3; r++){
+            // human-readable label, only used in the hosting RIBs' logs
+            ribs.first[r]->names.SetLabel(random_dc_name, "capsule" + std::to_string(i));
+        }
 
+        if (aggregateAds){
+            continue;
+        }
         CreateAndEnqueueAds(dcs1, random_dc_name);
         CreateAndEnqueueCert(dcs1, random_dc_name, dco1);
 
@@ -467,6 +586,26 @@ main(int argc, char* argv[])
         CreateAndEnqueueAds(dcs3, random_dc_name);
         CreateAndEnqueueCert(dcs3, random_dc_name, dco3);
     }
+    if (aggregateAds){
+        // * One ad and one prefix cert ("<owner>:*") per server cover all of the owner's names
+        CreateAndEnqueueAds(dcs1, dco1->my_name + ":*");
+        CreateAndEnqueueCert(dcs1, "*", dco1);
+
+        CreateAndEnqueueAds(dcs2, dco2->my_name + ":*");
+        CreateAndEnqueueCert(dcs2, "*", dco2);
+
+        CreateAndEnqueueAds(dcs3, dco3->my_name + ":*");
+        CreateAndEnqueueCert(dcs3, "*", dco3);
+    }
+    if (withdrawLast){
+        CreateAndEnqueueWithdrawal(dcs3, random_dc_name);
+    }
+    if (warmStart){
+        // * The RIBs already hold the ads, the servers only ask for switches
+        dcs1.advertiser->dcNameList.resize(1);
+        dcs2.advertiser->dcNameList.resize(1);
+        dcs3.advertiser->dcNameList.resize(1);
+    }
 
 
 
@@ -516,7 +655,7 @@ main(int argc, char* argv[])
             
     //     }
     // }
-    auto switches = installSwitches(switchAssgn, serverAssgn, Seconds(0.9), Seconds(GLOBAL_STOP_TIME));
+    auto switches = installSwitches(switchAssgn, ribs.first, Seconds(0.9), Seconds(GLOBAL_STOP_TIME));
 
 
 
@@ -531,7 +670,9 @@ main(int argc, char* argv[])
     // BUILD_CLIENT(7, "user:7", clientFactory, dummyClientApps)
     // BUILD_CLIENT(8, "user:8", clientFactory, dummyClientApps)
     // BUILD_CLIENT(9, "user:9", clientFactory, dummyClientApps)
-    dummyClientApps.Start(Seconds(300.0));
+    // Warm runs only wait for the switches to peer (15 s) and the DC servers to come up (30 s)
+    Time clientStart = warmStart ? Seconds(40.0) : Seconds(300.0);
+    dummyClientApps.Start(clientStart);
     dummyClientApps.Stop(Seconds(GLOBAL_STOP_TIME));
 
     MobilityHelper mh;
@@ -587,9 +728,27 @@ main(int argc, char* argv[])
         AsciiTraceHelper ascii;
         p2p.EnableAsciiAll(ascii.CreateFileStream("briteLeaves.tr"));
     }
+    if (!snapshotSave.empty()){
+        Simulator::Schedule(clientStart, [&]() { SaveRIBSnapshot(snapshotSave, ribs.first, topology); });
+    }
+
     // Run the simulator
     Simulator::Stop(Seconds(GLOBAL_STOP_TIME));
     Simulator::Run();
+
+    // * Compare runs with --dissemination=Flood and --dissemination=Gossip on the same topology
+    RIBAdStore::DisseminationStats total{0, 0, 0, Seconds(0)};
+    for (RIB* rib : ribs.first){
+        const RIBAdStore::DisseminationStats& stats = rib->adStore->GetDisseminationStats();
+        total.adsSent += stats.adsSent;
+        total.adsAccepted += stats.adsAccepted;
+        total.adsRedundant += stats.adsRedundant;
+        total.lastUpdate = std::max(total.lastUpdate, stats.lastUpdate);
+    }
+    NS_LOG_INFO("Dissemination " << dissemination << ": " << total.adsSent << " ads sent, "
+                << total.adsAccepted << " accepted, " << total.adsRedundant << " redundant, "
+                << "last update at " << total.lastUpdate.As(Time::S));
+
     Simulator::Destroy();
 
     return 0;
@@ -18,11 +18,16 @@
 #include <vector>
 #include <set>
 #include <unordered_map>
+#include <unordered_set>
 #include <cstdlib>
 #include <map>
 #include <string>
 #include <cassert>
 #include <random>
+#include <deque>
+#include <list>
+#include <functional>
+#include <memory>
 
 
 #define RIBADSTORE_PORT 3001
@@ -37,11 +42,75 @@
 #define CLIENT_PROBER_PORT 3010
 #define PACKET_MAGIC_UP 0xdeadface
 #define PACKET_MAGIC_DOWN 0xcafebabe
+#define AD_BATCH_MAGIC 0xAB
+#define RIB_SNAPSHOT_MAGIC 0x50414e53
+#define RIB_SNAPSHOT_VERSION 1
+#define MEMBER_LIST_MAGIC 0xB5
+#define SWITCH_SUB_RENEW_SECONDS 10     // well within RIBLinkStateManager::SubscriptionLease
+#define AD_TTL_REFRESHES 3              // ad TTL in refresh intervals: survives a lost refresh and the paced refresh flood
 
 using namespace ns3;
 
 /* Declaring the utility class to pass compilation */
 class NameDBEntry; 
+class NameDBEntryPool;
+class SnapshotWriter;
+class SnapshotReader;
+
+/* Owning handle for entries allocated from a NameDBEntryPool */
+struct NameDBEntryDeleter {
+    NameDBEntryPool* pool;
+    void operator()(NameDBEntry* entry) const;
+};
+typedef std::unique_ptr<NameDBEntry, NameDBEntryDeleter> NameDBEntryPtr;
+
+/* Per-RIB slab allocator for NameDBEntry. Entries are carved out of
+ * SLAB_SIZE-entry slabs and recycled through a free list, so flooding does
+ * not hit the heap for every received ad. Slabs live as long as the pool. */
+class NameDBEntryPool {
+public:
+    static const size_t SLAB_SIZE = 256;
+
+    NameDBEntryPool();
+    ~NameDBEntryPool();
+    NameDBEntryPool(const NameDBEntryPool&) = delete;
+    NameDBEntryPool& operator=(const NameDBEntryPool&) = delete;
+
+    template <typename... Args>
+    NameDBEntryPtr Create(Args&&... args);             // defined after NameDBEntry
+    size_t GetLiveCount() const;
+    size_t GetSlabCount() const;
+
+private:
+    friend struct NameDBEntryDeleter;
+    void* Allocate();
+    void Release(NameDBEntry* entry);
+
+    std::vector<void*> slabs;
+    std::vector<void*> free_slots;
+    size_t live;
+};
+
+/* AS-level path of an ad, stored inline. Paths longer than CAPACITY are
+ * rejected when the ad is parsed. */
+class TdPath {
+public:
+    static const uint32_t CAPACITY = 32;
+
+    TdPath() : count(0) {}
+    bool push_back(const Ipv4Address& addr);            // false if full
+    size_t size() const { return count; }
+    bool empty() const { return count == 0; }
+    bool full() const { return count == CAPACITY; }
+    Ipv4Address& operator[](size_t i) { return hops[i]; }
+    const Ipv4Address& operator[](size_t i) const { return hops[i]; }
+    const Ipv4Address* begin() const { return hops; }
+    const Ipv4Address* end() const { return hops + count; }
+
+private:
+    Ipv4Address hops[CAPACITY];
+    uint8_t count;
+};
 
 /* Global map for mapping AS with their addresses*/
 extern std::map<int, Address> global_AS_to_addr;
@@ -59,9 +128,387 @@ struct Graph {
     void FloydWarshall();
 };
 
+/* DataCapsule names are SHA-256 digests of the capsule's metadata. Text
+ * protocols (JSON, certs, trust graph keys) carry the 64-char lowercase hex
+ * form; binary ads carry the 32 raw bytes. */
+class DCName {
+public:
+    static const size_t ID_SIZE = 32;
+
+    static std::string FromMetadata(const std::string& metadata);
+    static bool IsId(const std::string& name);
+    static bool ToBytes(const std::string& id, uint8_t* out);       // false if name is not an ID
+    static std::string FromBytes(const uint8_t* bytes);
+    static void Sha256(const uint8_t* data, size_t len, uint8_t* out);
+};
+
+/* Per-RIB name table: interns the IDs a RIB stores so every map keyed by
+ * the same name shares one copy, and keeps the human-readable label for the
+ * few IDs that have one (log output only). */
+class DCNameTable {
+public:
+    const std::string& Intern(const std::string& id);
+    void SetLabel(const std::string& id, const std::string& label);
+    std::string GetLabel(const std::string& id) const;                // label, or the ID itself
+    size_t Size() const;
+
+private:
+    std::unordered_set<std::string> ids;
+    std::unordered_map<std::string, std::string> labels;
+};
+
+/* Compressed (radix) trie over qualified DC names ("owner:ID"), used by the
+ * ad store to answer owner-prefix queries such as "fogrobotics2:*". */
+class NameTrie {
+public:
+    NameTrie();
+    void Insert(const std::string& key);
+    void Erase(const std::string& key);
+    bool Contains(const std::string& key) const;
+    // Appends every key starting with prefix, in lexicographic order, up to limit keys (0 = no limit).
+    void Collect(const std::string& prefix, std::vector<std::string>& out, size_t limit = 0) const;
+    size_t Size() const;
+
+private:
+    struct Node {
+        std::string label;                                  // edge label leading to this node
+        bool terminal = false;
+        std::map<char, std::unique_ptr<Node>> children;
+    };
+
+    static void CollectAll(const Node* node, std::string& path, std::vector<std::string>& out, size_t limit);
+    static bool EraseFrom(Node* node, const std::string& key, size_t pos);
+
+    Node root;
+    size_t count;
+};
+
+/* Consistent hash ring over the RIB replicas (shards) of one TD. Every shard
+ * owns VNODES points of the ring; a key belongs to the first point at or after
+ * its Hash64. Shard 0 is the TD's primary RIB. */
+class RIBShardRing {
+public:
+    static const uint32_t VNODES = 64;
+
+    void AddShard(const Address& addr);
+    size_t Size() const;
+    const Address& GetShard(uint32_t index) const;
+    uint32_t OwnerIndex(const std::string& key) const;
+    const Address& Owner(const std::string& key) const;
+    bool Contains(const Address& addr) const;
+
+private:
+    std::vector<Address> shards;
+    std::map<uint64_t, uint32_t> ring;                  // point -> shard index
+};
+
+/* Binary GIVEPEERS / GIVESWITCHES replies, all integers in network order:
+ *   u8 magic (0xB5) | u8 kind | u32 version | u16 count | count x (u32 ipv4 | u32 TD)
+ * A request may carry the version the requester has ("GIVEPEERS <version>");
+ * if the list is not newer it gets a NOT_MODIFIED reply, with no entries. */
+class MemberList {
+public:
+    enum Kind { FULL = 0, NOT_MODIFIED = 1 };
+    typedef std::vector<std::pair<Ipv4Address, uint32_t>> Entries;    // (address, TD)
+
+    static std::string Encode(uint32_t version, const Entries& entries);
+    static std::string NotModified(uint32_t version);
+    // false if msg is not a member list (e.g. a NACK)
+    static bool Decode(const std::string& msg, uint32_t& version, bool& not_modified, Entries& entries);
+    static uint32_t GetVersion(const std::string& list);
+    // Version in "<verb> <version>", false for an unconditional request
+    static bool ParseSince(const std::string& request, size_t verb_len, uint32_t& since);
+};
+
+/* A subscriber's copy of the live switches of a RIB, kept in step by the
+ * versioned SWITCHES (whole set) and SWDELTA (changes) pushes of its link-state
+ * manager. Apply returns false on a delta that does not follow our version:
+ * the subscriber then sends SubscribeRequest() to get the whole set again. */
+class SwitchMembership {
+public:
+    SwitchMembership();
+    static bool IsPush(const std::string& msg);
+    bool Apply(const std::string& msg, std::vector<Ipv4Address>& added, std::vector<Ipv4Address>& removed);
+    std::string SubscribeRequest() const;
+    uint32_t GetVersion() const;
+    const std::set<Ipv4Address>& GetSwitches() const;
+
+private:
+    uint32_t version;
+    std::set<Ipv4Address> switches;
+};
+
+/* Merkle tree over a RIB's cert set, used for anti-entropy between peered RIBs.
+ * Certs are bucketed into leaves by hash; a leaf digest is the (order independent)
+ * sum of its cert hashes, so inserts update one root-to-leaf path only. */
+class CertMerkleTree {
+public:
+    static const uint32_t DEPTH = 8;                    // 2^DEPTH leaves
+
+    CertMerkleTree();
+    bool Insert(const std::string& cert);               // false if already present
+    bool Contains(const std::string& cert) const;
+    uint64_t GetDigest(uint32_t level, uint32_t index) const;
+    const std::set<std::string>& GetLeaf(uint32_t index) const;
+    size_t Size() const;
+
+private:
+    std::vector<std::set<std::string>> leaves;
+    std::vector<uint64_t> nodes;                        // heap layout, node 1 is the root
+    size_t count;
+};
+
 
 namespace ns3{
 
+    /* Single-flight bookkeeping for RIB queries: requests with the same key that
+     * arrive while one is being answered wait for that answer instead of
+     * computing their own, and all of them get the same serialized packet. */
+    class QueryFlights
+    {
+    public:
+        typedef void (*TracedCallback)(const std::string& key, uint32_t requesters);
+
+        // Returns true if this is the first requester, i.e. the caller should compute the answer.
+        bool Join(const std::string& key, Ptr<Socket> socket, Address dest);
+        uint32_t GetWaiting(const std::string& key) const;
+        // Sends response (if not null) to everyone waiting on key and returns who that was.
+        std::vector<Address> Complete(const std::string& key, Ptr<Packet> response);
+        // Same, for answers streamed as several datagrams.
+        std::vector<Address> Complete(const std::string& key, const std::vector<Ptr<Packet>>& responses);
+
+    private:
+        std::map<std::string, std::vector<std::pair<Ptr<Socket>, Address>>> m_waiting;
+    };
+
+    /* Per-RIB service model. Requests handed to Submit() wait in a FIFO until
+     * one of Cores workers is free, occupy it for the opcode's cost and only
+     * then run. Zero-cost work on an idle RIB runs inline, as before. */
+    class RIBServiceQueue : public Object
+    {
+    public:
+        enum Opcode
+        {
+            OP_GIVESWITCHES = 0,
+            OP_GIVEADS,
+            OP_GIVEPATH,
+            OP_AD,
+            OP_CERT,
+            OP_ANTIENTROPY,
+            OP_COUNT
+        };
+
+        enum ShedMode
+        {
+            SHED_DROP,
+            SHED_NACK
+        };
+
+        typedef void (*ServedCallback)(uint32_t opcode, Time queueDelay);
+        typedef void (*ShedCallback)(uint32_t opcode, uint32_t queueDepth);
+
+        static TypeId GetTypeId();
+        RIBServiceQueue();
+        ~RIBServiceQueue() override;
+
+        // Returns false if the request was shed; the caller decides what to tell the requester.
+        // Only client queries are shed, see IsSheddable().
+        bool Submit(Opcode op, std::function<void()> work);
+        static bool IsSheddable(Opcode op);
+        // "NACK:<opcode>" in SHED_NACK mode, null in SHED_DROP mode.
+        Ptr<Packet> GetShedReply(Opcode op) const;
+        Time GetCost(Opcode op) const;
+        uint32_t GetQueueDepth() const;
+        static std::string GetOpcodeName(Opcode op);
+
+    private:
+        struct Job
+        {
+            Opcode op;
+            std::function<void()> work;
+            Time enqueued;
+        };
+
+        void StartJobs();
+        void FinishJob(Job job);
+        void RunJob(Job& job);
+
+        uint32_t m_cores;
+        uint32_t m_maxQueueDepth;        //!< 0 means unbounded
+        ShedMode m_shedMode;
+        Time m_giveSwitchesCost;
+        Time m_giveAdsCost;
+        Time m_givePathCost;
+        Time m_adCost;
+        Time m_certCost;
+        Time m_antiEntropyCost;
+        bool m_calibrate;                //!< Replace configured costs by measured wall-clock cost
+        double m_calibrationScale;
+        double m_calibrationWeight;
+        double m_measured[OP_COUNT];     //!< EWMA of wall-clock seconds per opcode, < 0 if never measured
+
+        uint32_t m_busy;
+        std::deque<Job> m_queue;
+        TracedCallback<uint32_t, Time> m_servedTrace;
+        TracedCallback<uint32_t, uint32_t> m_shedTrace;
+    };
+
+    /* Binary advertisement, version 4. All integers in network order:
+     *   u8 magic (0xAD) | u8 version | u16 td_path length | u32 origin AS | u32 origin server
+     *   | u32 td_path[length] | u8 name kind (1: 32-byte DCName ID | 0: u16 len + dc name)
+     *   | u8 has trust cert [ | u16 len + issuer | u16 len + entity | u32 r_transitivity ]
+     *   | u16 distrust count | { u16 len + issuer | u16 len + entity }*
+     *   | u8 withdrawn | u32 seq                                          (v3+)
+     *   | u32 ttl                                                         (v4+)
+     * Versions 1 to 3 are still accepted: version 1 had no name kind byte
+     * (always u16 len + name), versions before 3 have no withdrawn/seq
+     * trailer and versions before 4 no ttl (read as 0, never expires).
+     * A JSON ad always starts with '{', so the first byte tells the two apart. */
+    class AdvertisementHeader : public Header
+    {
+    public:
+        static const uint8_t MAGIC = 0xAD;
+        static const uint8_t VERSION = 4;
+
+        static TypeId GetTypeId();
+        TypeId GetInstanceTypeId() const override;
+        uint32_t GetSerializedSize() const override;
+        void Serialize(Buffer::Iterator start) const override;
+        uint32_t Deserialize(Buffer::Iterator start) override;
+        void Print(std::ostream& os) const override;
+
+        bool IsValid() const;
+
+        std::string dc_name;
+        Ipv4Address origin_AS_addr;
+        Ipv4Address origin_server;
+        std::vector<Ipv4Address> td_path;
+        bool has_trust_cert = false;
+        std::string trust_issuer;
+        std::string trust_entity;
+        int32_t r_transitivity = 0;
+        std::vector<std::pair<std::string, std::string>> distrust_certs;    // (issuer, entity)
+        uint32_t seq = 0;               // per-origin sequence number, v3 and later
+        bool withdrawn = false;
+        uint32_t ttl = 0;               // seconds, 0 never expires, v4 and later
+
+    private:
+        bool m_valid = true;
+    };
+
+    /* Identity of a binary ad for duplicate suppression: two copies of an ad
+     * flooded over different peers share origin, name and certs. */
+    struct AdDigest
+    {
+        uint32_t origin_AS;
+        uint64_t name_hash;
+        uint64_t cert_hash;
+        uint16_t path_len;
+    };
+
+    /* Reads only what AdDigest needs from a binary ad; meant for PeekHeader so
+     * a duplicate can be dropped before AdvertisementHeader is deserialized. */
+    class AdvertisementDigestHeader : public Header
+    {
+    public:
+        static TypeId GetTypeId();
+        TypeId GetInstanceTypeId() const override;
+        uint32_t GetSerializedSize() const override;
+        void Serialize(Buffer::Iterator start) const override;
+        uint32_t Deserialize(Buffer::Iterator start) override;
+        void Print(std::ostream& os) const override;
+
+        bool IsValid() const;
+        const AdDigest& GetDigest() const;
+
+    private:
+        AdDigest m_digest;
+        uint32_t m_size = 0;
+        bool m_valid = false;
+    };
+
+    /* Bounded LRU of ad digests -> shortest td_path accepted for that digest. */
+    class AdSeenCache
+    {
+    public:
+        AdSeenCache();
+        void SetCapacity(uint32_t capacity);
+        uint32_t GetCapacity() const;
+        // True if an ad with the same digest and a path no longer than this one was accepted before.
+        bool IsDuplicate(const AdDigest& digest);
+        void Insert(const AdDigest& digest);
+        void Erase(const AdDigest& digest);
+
+    private:
+        struct Key
+        {
+            uint32_t origin_AS;
+            uint64_t name_hash;
+            uint64_t cert_hash;
+            bool operator==(const Key& other) const;
+        };
+        struct KeyHash
+        {
+            size_t operator()(const Key& key) const;
+        };
+        typedef std::list<std::pair<Key, uint16_t>> LruList;
+
+        uint32_t m_capacity;
+        LruList m_lru;                                      // most recently used first
+        std::unordered_map<Key, LruList::iterator, KeyHash> m_index;
+    };
+
+    /* Coarse hashed timer wheel for ad expiry: one periodic tick for all ads
+     * instead of an event per ad. Keys come back when their slot is due; the
+     * caller checks the real expiry time and files refreshed keys again, so a
+     * refresh never has to touch the wheel. */
+    class ExpiryWheel
+    {
+    public:
+        typedef std::pair<std::string, uint32_t> Key;  // (dc name, origin AS)
+
+        ExpiryWheel();
+        void Configure(Time granularity, uint32_t slots);
+        Time GetGranularity() const;
+        void Schedule(const Key& key, Time when);
+        // Keys of all slots that came due up to now
+        std::vector<Key> Advance(Time now);
+        size_t Size() const;
+
+    private:
+        std::vector<std::vector<Key>> m_slots;
+        std::set<Key> m_filed;                          // each key is in at most one slot
+        Time m_granularity;
+        uint32_t m_current;
+        int64_t m_currentTick;
+        size_t m_count;
+    };
+
+    /* Counting Bloom filter over DC names. The origin keeps real counters so
+     * names can be removed; a received summary only needs the bit view, which
+     * is what gets sent (bit i is set iff counter i is non-zero). Add/Remove
+     * return the bits that flipped, i.e. the incremental update to send. */
+    class CountingBloomFilter
+    {
+    public:
+        CountingBloomFilter();
+        void Reset(uint32_t bits, uint32_t hashes);
+        std::vector<uint32_t> Add(const std::string& key);
+        std::vector<uint32_t> Remove(const std::string& key);
+        bool MayContain(const std::string& key) const;
+        void SetBit(uint32_t index, bool set);
+        uint32_t GetBits() const;
+        uint32_t GetHashes() const;
+        std::string ToHex() const;
+        bool FromHex(uint32_t bits, uint32_t hashes, const std::string& hex);
+
+    private:
+        std::vector<uint32_t> Indices(const std::string& key) const;
+
+        std::vector<uint8_t> m_counters;                    // saturate at 255 and then stick
+        uint32_t m_hashes;
+    };
+
     class DCServerAdvertiser : public Application
     {
     public:
@@ -83,6 +530,12 @@ namespace ns3{
         void StartApplication() override;
         void StopApplication() override;
         void Send();
+        void Refresh();
+
+        Time m_adTtl;                            //!< TTL put into every ad, 0 for none
+        Time m_refreshInterval;                  //!< Time between refresh digests, 0 for none
+        EventId m_refreshEvent;
+        std::set<std::string> m_advertised;      //!< Names currently advertised, for the refresh digest
 
         uint32_t m_count; //!< Maximum number of packets the application will send
         Time m_interval;  //!< Packet inter-send time
@@ -173,6 +626,30 @@ namespace ns3{
     class RIBAdStore : public Application
     {
     public:
+        enum DisseminationMode
+        {
+            DISSEMINATE_FLOOD,           //!< Forward every updated ad to every peer
+            DISSEMINATE_GOSSIP           //!< Push to GossipFanout random peers, pull from one peer per round
+        };
+
+        // Order of the origins of a name in db and in GIVEADS replies
+        enum RankMode
+        {
+            RANK_PATH_LENGTH,            //!< Fewest TD hops first, latency breaks ties
+            RANK_LATENCY                 //!< Lowest estimated latency to the origin AS first
+        };
+
+        // Counters to compare dissemination modes over a run
+        struct DisseminationStats
+        {
+            uint64_t adsSent;            //!< Ads (and withdrawals) sent to peers
+            uint64_t adsAccepted;        //!< Received ads that changed db
+            uint64_t adsRedundant;       //!< Received ads that did not
+            Time lastUpdate;             //!< Last time db changed
+        };
+
+        typedef void (*ExpiredCallback)(const std::string& dc_name, Ipv4Address origin);
+
         static TypeId GetTypeId();
         RIBAdStore();
         ~RIBAdStore() override;
@@ -180,10 +657,19 @@ namespace ns3{
         uint64_t GetReceived() const;
         uint16_t GetPacketWindowSize() const;
         void SetPacketWindowSize(uint16_t size);
+        int64_t AssignStreams(int64_t stream) override;
+        uint32_t GetSeenCacheSize() const;
+        void SetSeenCacheSize(uint32_t size);
         void SetContext(void *ctx);
-        void SendOverlaySwitches(Ptr<Socket> socket, Address dest);
-        void SendClients(Ptr<Socket> socket, Address dest, std::string name);
-        std::unordered_map<std::string, std::vector<NameDBEntry*>> db;
+        Ptr<Packet> BuildOverlaySwitchesResponse();
+        std::vector<Ptr<Packet>> BuildClientsResponse(std::string name);
+        static std::string QualifiedName(const NameDBEntry& entry);
+        void NotifyDistrust(const std::string& issuer, const std::string& entity);
+        const DisseminationStats& GetDisseminationStats() const;
+        void SaveState(SnapshotWriter& out);
+        bool LoadState(SnapshotReader& in);
+        NameDBEntryPool entryPool;       // declared before db so it outlives the entries
+        std::unordered_map<std::string, std::vector<NameDBEntryPtr>> db;
 
         void *parent_ctx;
     protected:
@@ -193,8 +679,51 @@ namespace ns3{
         void StartApplication() override;
         void StopApplication() override;
         void HandleRead(Ptr<Socket> socket);
-        bool UpdateNameCache(NameDBEntry* entry);
-        void ForwardAds(Ptr<Socket> socket, std::string& content, Address dest);
+        bool UpdateNameCache(NameDBEntryPtr entry);
+        bool RemoveFromNameCache(const NameDBEntry& withdrawal);
+        bool ApplyWithdrawal(Ptr<Socket> socket, NameDBEntryPtr withdrawal, Address from);
+        std::vector<std::pair<std::string, std::string>> AdEdges(const NameDBEntry* entry);
+        void RetainAdEdges(NameDBEntry* entry);
+        void ReleaseAdEdges(NameDBEntry* entry);
+        void ForwardAds(Ptr<Socket> socket, Ptr<Packet> content, Address dest);
+        void EnqueueAd(Ptr<Socket> socket, NameDBEntry* entry, Ptr<Packet> content, Address dest);
+        void FlushAds(Address dest);
+        Ptr<Packet> BuildAdBatch(const std::vector<Ptr<Packet>>& ads);
+        std::vector<Ptr<Packet>> SplitAdBatch(Ptr<Packet> packet);
+        Ptr<Packet> SerializeAd(NameDBEntry* entry);
+        void ProcessAd(Ptr<Socket> socket, Ptr<Packet> packet, Address from);
+        void HandleQuery(Ptr<Socket> socket, Address from, std::string key);
+        void SubmitQuery(std::string key);
+        void AnswerQuery(std::string key);
+        void AddToSummary(const std::string& dc_name);
+        void RemoveFromSummary(const std::string& dc_name);
+        void FlushSummary();
+        void HandleSummary(Ptr<Socket> socket, Address from, std::string& msg);
+        bool ResolveName(const std::string& name);
+        void HandleResolve(Ptr<Socket> socket, Address from, std::string& msg);
+        void ForwardResolved(Ptr<Socket> socket, NameDBEntry* entry, Ptr<Packet> serialized);
+        void SelectGossipPeers(std::vector<Address>& dests);
+        void PullRound();
+        void HandlePull(Ptr<Socket> socket, Address from, std::string& msg);
+        void HandleServerRefresh(Ptr<Socket> socket, Address from, std::string& msg);
+        void FloodRefresh();
+        void HandleRefresh(Ptr<Socket> socket, Address from, std::string& msg);
+        void EnqueueRefresh(Ptr<Socket> socket, Address dest, uint32_t origin, uint32_t epoch, uint32_t chunk, const std::string& msg);
+        void ScheduleFlush(EventId& flushEvent, Time nextAllowed, Address dest);
+        void IndexAd(NameDBEntry* entry);
+        void UnindexAd(NameDBEntry* entry);
+        void HandleAdPull(Ptr<Socket> socket, Address from, std::string& msg);
+        void ForgetSeen(NameDBEntry* entry);
+        void ExpiryTick();
+        void ScheduleExpiry(NameDBEntry* entry);
+        void ShareWithShard(const std::string& dc_name);
+        void FlushShards();
+        void HandleShardAds(std::string& msg);
+        static uint64_t EntryDigest(const NameDBEntry& entry);
+        Time EstimateLatency(const NameDBEntry& entry);
+        bool RankedBefore(const NameDBEntry& a, const NameDBEntry& b) const;
+        void InsertRanked(std::vector<NameDBEntryPtr>& all_ads, NameDBEntryPtr entry);
+        std::vector<std::string> PackAds(const std::vector<NameDBEntry*>& entries, bool stream);
 
         uint16_t m_port;                 //!< Port on which we listen for incoming packets.
         Ptr<Socket> m_socket;            //!< IPv4 Socket
@@ -206,6 +735,73 @@ namespace ns3{
 
         /// Callbacks for tracing the packet Rx events, includes source and destination addresses
         TracedCallback<Ptr<const Packet>, const Address&, const Address&> m_rxTraceWithAddresses;
+
+        QueryFlights m_flights;
+        Time m_coalesceWindow;           //!< How long a query waits for identical ones before being answered
+        bool m_binaryAds;                //!< Forward ads to peer RIBs in the binary encoding
+        uint32_t m_batchMtu;
+        Time m_batchFlushInterval;
+        Time m_mrai;
+        Ptr<UniformRandomVariable> m_rng;
+
+        NameTrie m_nameIndex;            //!< Qualified names of stored ads, for prefix GIVEADS
+        uint32_t m_responseMtu;
+        RankMode m_rankBy;
+        std::map<uint32_t, Time> m_peerDelay;                                  //!< Peer -> smoothed one-hop delay of its datagrams
+        std::unordered_map<std::string, std::vector<std::string>> m_rankedAds; //!< Name -> serialized GIVEADS reply, dropped when db changes
+        std::vector<NameDBEntry*> ResolveQualifiedName(const std::string& key);
+
+        std::unordered_map<std::string, uint32_t> m_originSeq;                 //!< Last sequence number per name we originate
+        std::map<std::pair<std::string, uint32_t>, uint32_t> m_withdrawn;      //!< (name, origin AS) -> withdrawn up to seq
+
+        // Summary mode: origins flood Bloom summaries of their names instead of the ads,
+        // which are fetched hop by hop towards the origin when a client asks for them
+        bool m_summaryMode;
+        uint32_t m_summaryBits;
+        uint32_t m_summaryHashes;
+        Time m_resolveTimeout;
+        CountingBloomFilter m_localSummary;                                    //!< Names we originate
+        std::unordered_set<std::string> m_summaryNames;
+        uint32_t m_summaryVersion;
+        std::map<uint32_t, bool> m_summaryDelta;                               //!< Bits changed since the last flush
+        EventId m_summaryEvent;
+        struct RemoteSummary
+        {
+            uint32_t version;
+            CountingBloomFilter filter;
+            Address nextHop;             //!< Peer the latest version came from, towards the origin
+        };
+        std::map<uint32_t, RemoteSummary> m_summaries;                         //!< Origin AS -> summary
+        std::map<std::pair<std::string, uint32_t>, std::set<Address>> m_pendingResolves;   //!< (name, origin AS) -> peers asking
+        std::map<std::string, EventId> m_resolving;                            //!< Client queries waiting for a fetched ad
+
+        DisseminationMode m_dissemination;
+        uint32_t m_gossipFanout;
+        Time m_gossipInterval;           //!< Time between pull rounds
+        EventId m_pullEvent;
+        DisseminationStats m_stats;
+
+        ExpiryWheel m_expiry;
+        Time m_expiryGranularity;
+        EventId m_expiryEvent;
+        uint32_t m_refreshEpoch;         //!< Of the refreshes we originate
+        EventId m_refreshEvent;
+        struct RefreshSeen
+        {
+            uint32_t epoch;
+            std::set<uint32_t> chunks;
+        };
+        std::map<uint32_t, RefreshSeen> m_refreshSeen;                         //!< Origin AS -> latest refresh flooded on
+        std::unordered_map<uint32_t, std::unordered_map<uint64_t, NameDBEntry*>> m_byOrigin;   //!< Origin AS -> EntryDigest -> stored ad
+        TracedCallback<const std::string&, Ipv4Address> m_expiredTrace;
+
+        std::set<std::string> m_shardDirty;                                    //!< Names whose ads changed since the last push to their shard
+        EventId m_shardEvent;
+
+        AdSeenCache m_seenCache;
+        TracedCallback<Ptr<const Packet>> m_duplicateAdTrace;
+        TracedCallback<const std::string&, uint32_t> m_queryCoalescedTrace;
+        TracedCallback<const std::string&, uint32_t> m_queryAnsweredTrace;
     };
 
 
@@ -224,6 +820,8 @@ namespace ns3{
         void SetRemote(Address ip, uint16_t port);
         void SetRemote(Address addr);
         uint64_t GetTotalTx() const;
+        uint64_t GetSuppressed() const;
+        void NotifyTraffic();
 
     protected:
         void DoDispose() override;
@@ -232,9 +830,16 @@ namespace ns3{
         void StartApplication() override;
         void StopApplication() override;
         void Send();
+        void HandleRead(Ptr<Socket> socket);
 
         uint32_t m_count; //!< Maximum number of packets the application will send
         Time m_interval;  //!< Packet inter-send time
+        Time m_maxInterval;      //!< Backoff limit of the heartbeat interval
+        Time m_currentInterval;
+        bool m_backingOff;       //!< False until a heartbeat at the base interval went out
+        Time m_lastHeartbeat;
+        Time m_lastTraffic;      //!< Last other packet to the RIB, piggybacking liveness
+        uint64_t m_suppressed;   //!< Heartbeats skipped thanks to other traffic
         uint32_t m_size;  //!< Size of the sent packet (including the SeqTsHeader)
 
         uint32_t m_sent;       //!< Counter for sent packets
@@ -307,6 +912,12 @@ namespace ns3{
         void SetPacketWindowSize(uint16_t size);
         std::set<Ipv4Address> liveSwitches;
         void *parent_ctx;
+        void SharePeers();
+        const std::string& GetSwitchList();
+        uint32_t GetSwitchVersion();
+
+        typedef void (*SwitchUpCallback)(Ipv4Address addr);
+        typedef void (*SwitchDownCallback)(Ipv4Address addr, Time silence);
 
     protected:
         void DoDispose() override;
@@ -315,7 +926,37 @@ namespace ns3{
         void StartApplication() override;
         void StopApplication() override;
         void HandleRead(Ptr<Socket> socket);
-        void SendPeers(Ptr<Socket> socket, Address addr);
+        void SendPeers(Ptr<Socket> socket, Address addr, const std::string& request);
+        void ShareWithShards(const std::string& msg);
+        void HandleShard(const std::string& msg);
+        void Sweep();
+        void HandleSubscribe(Ptr<Socket> socket, Address from, const std::string& msg);
+        bool AddSwitch(Ipv4Address addr);
+        bool RemoveSwitch(Ipv4Address addr);
+        void RecordChange(Ipv4Address addr, bool added);
+        void FlushDelta();
+
+        std::string m_primaryPeers;      //!< GIVEPEERS reply of the primary, on replicas
+        struct SwitchLiveness
+        {
+            Time lastSeen;
+            Time interval;               //!< Heartbeat interval the switch announced last, zero if none
+        };
+        std::map<Ipv4Address, SwitchLiveness> m_liveness;  //!< Switches heartbeating this RIB
+        Time m_heartbeatTimeout;
+        uint32_t m_missedHeartbeats;
+        Time m_sweepInterval;
+        EventId m_sweepEvent;
+        TracedCallback<Ipv4Address> m_switchUpTrace;
+        TracedCallback<Ipv4Address, Time> m_switchDownTrace;
+
+        uint32_t m_switchVersion;                //!< Bumped by every delta of liveSwitches
+        std::string m_switchList;                //!< Cached MemberList of liveSwitches
+        bool m_switchListStale;
+        std::map<Ipv4Address, bool> m_switchDelta;   //!< Switch -> added (true) or removed, not yet pushed
+        EventId m_deltaEvent;
+        std::map<Address, Time> m_subscribers;   //!< Subscriber -> lease end
+        Time m_subscriptionLease;
 
         uint16_t m_port;                 //!< Port on which we listen for incoming packets.
         Ptr<Socket> m_socket;            //!< IPv4 Socket
@@ -342,10 +983,24 @@ namespace ns3{
         uint16_t GetPacketWindowSize() const;
         void SetContext(void *ctx);
         void SetPacketWindowSize(uint16_t size);
+        void NotifyRevocation();
+        void NotifyEdgeRemoved(const std::string& issuer, const std::string& entity);
         void *parent_ctx;
 
         Graph trust_graph;
 
+        // A path handed out to a client. Kept so that a later distrust can be
+        // pushed to exactly the clients whose paths go through the revoked node.
+        struct PathGrant {
+            Address client;
+            std::string client_name;
+            std::string dc_name;
+            std::string dc_server;
+            std::vector<std::string> hops;      // TDs on the path, followed by the DC server
+        };
+        std::map<std::pair<Address, std::string>, PathGrant> path_grants;                 // (client, dc_name) -> grant
+        std::map<std::string, std::set<std::pair<Address, std::string>>> node_subscribers; // trust graph node -> (client, dc_name)
+
     protected:
         void DoDispose() override;
 
@@ -354,9 +1009,16 @@ namespace ns3{
         void StopApplication() override;
         void HandleRead(Ptr<Socket> socket);
         void ComputeGraph();
+        void RebuildGraph();
         bool isItMe(std::string entity);
         std::vector<std::string> GetPath(std::string startNode, std::string endNode);
-        void SendPath(Ptr<Socket> socket, Address dest, std::string path);
+        std::vector<std::string> GetPathHops(std::string client_name, std::string dc_server);
+        void SubmitPath(std::string key, std::string client_name, std::string dc_name);
+        void AnswerPath(std::string key, std::string client_name, std::string dc_name);
+        void RecordPathGrant(Address client, std::string client_name, std::string dc_name, std::string dc_server, std::vector<std::string>& hops);
+        void DropPathGrant(std::pair<Address, std::string> key);
+        void CheckPathGrants();
+        void SendPathInvalidation(const PathGrant& grant);
 
         uint16_t m_port;                 //!< Port on which we listen for incoming packets.
         Ptr<Socket> m_socket;            //!< IPv4 Socket
@@ -370,6 +1032,14 @@ namespace ns3{
         /// Callbacks for tracing the packet Rx events, includes source and destination addresses
         TracedCallback<Ptr<const Packet>, const Address&, const Address&> m_rxTraceWithAddresses;
 
+        std::set<std::string> revoked_nodes;   // distrusted entities not yet checked against path_grants
+        EventId m_revocationEvent;
+
+        QueryFlights m_flights;
+        Time m_coalesceWindow;           //!< How long a query waits for identical ones before being answered
+        TracedCallback<const std::string&, uint32_t> m_queryCoalescedTrace;
+        TracedCallback<const std::string&, uint32_t> m_queryAnsweredTrace;
+
     };
 
     class RIBCertStore: public Application
@@ -389,6 +1059,33 @@ namespace ns3{
         std::multimap<std::string, std::pair<std::string, int>> trustRelations;
         std::multimap<std::string, std::string> distrustRelations;
 
+        // All cert inserts go through these so the Merkle digest stays in sync.
+        // Return false if the relation was already known.
+        bool InsertTrust(const std::string& issuer, const std::string& entity, int r_transitivity);
+        bool InsertDistrust(const std::string& issuer, const std::string& entity);
+
+        // Trust edges derived from stored ads (td_path hops, origin AS -> server). They are
+        // reference counted per ad and dropped from trustRelations when the last ad goes.
+        void RetainAdEdge(const std::string& issuer, const std::string& entity);
+        void ReleaseAdEdge(const std::string& issuer, const std::string& entity);
+        std::map<std::pair<std::string, std::string>, uint32_t> adEdgeRefs;
+
+        // Owner certs of the form "<owner>:<dc name> trusts <server ip>", indexed by dc name
+        // with the server already parsed, so ad validation is a single lookup.
+        // Prefix certs "<owner>:* trusts <server ip>" cover all of the owner's names and are
+        // indexed under "<owner>:*", the name of the aggregated ad they validate.
+        struct OwnerTrust {
+            std::string issuer;
+            std::string entity;
+            Ipv4Address server;
+            int r_transitivity;
+        };
+        std::unordered_map<std::string, std::vector<OwnerTrust>> ownerIndex;
+        const OwnerTrust* FindOwnerTrust(const std::string& dc_name, const Ipv4Address& server) const;
+        static std::string CertName(const std::string& issuer);
+        void SaveState(SnapshotWriter& out);
+        bool LoadState(SnapshotReader& in);
+
 
     protected:
         void DoDispose() override;
@@ -397,6 +1094,22 @@ namespace ns3{
         void StartApplication() override;
         void StopApplication() override;
         void HandleRead(Ptr<Socket> socket);
+        void ProcessCert(Ptr<Socket> socket, Ptr<Packet> packet, Address from);
+        void AntiEntropy();
+        void HandleSync(Ptr<Socket> socket, Address from, std::string& msg);
+        void HandleLeaf(Ptr<Socket> socket, Address from, std::string& msg);
+        void SendLeaf(Ptr<Socket> socket, Address dest, uint32_t index, bool want_reply, const std::set<std::string>* except);
+        bool MergeCert(const std::string& cert);
+        void ShareWithShards(const std::string& cert);
+        void FlushShards();
+        void HandleShardCerts(std::string& msg);
+
+        Time m_antiEntropyInterval;      //!< Time between digest exchanges with peers
+        EventId m_antiEntropyEvent;
+        CertMerkleTree m_certTree;
+        std::vector<std::string> m_shardCerts;   //!< Inserted certs not yet pushed to the other shards
+        EventId m_shardEvent;
+        bool m_fromShard;                        //!< Applying a shard push, don't push it back
 
         uint16_t m_port;                 //!< Port on which we listen for incoming packets.
         Ptr<Socket> m_socket;            //!< IPv4 Socket
@@ -458,8 +1171,12 @@ namespace ns3{
         void HandlePeersCallback(Ptr<Socket> sock);
         std::map<int, Ipv4Address> temp_peering_rib_addrs;
         void PopulateSwitches(int __td_num, Ipv4Address addr);
+        void SubscribeSwitches(int __td_num);
+        void RenewSubscriptions();
         void HandleSwitchesCallback(Ptr<Socket> sock);
-        std::vector<Ptr<Socket>> giveswitches_sockets;
+        std::map<int, Ptr<Socket>> switch_sub_sockets;      // peer TD -> subscription with its RIB
+        std::map<int, SwitchMembership> switch_views;
+        EventId m_renewEvent;
         std::map<Address, Ptr<Socket>> sock_cache;
 
     };
@@ -495,6 +1212,7 @@ namespace ns3{
         Address m_peerAddress; //!< Remote peer address
         uint16_t m_peerPort;   //!< Remote peer port
         EventId m_sendEvent;   //!< Event to send the next packet
+        uint32_t m_switchVersion; //!< Version of switches_in_my_td
     #ifdef NS3_LOG_ENABLE
         std::string m_peerAddressString; //!< Remote peer address string
     #endif
@@ -515,6 +1233,7 @@ namespace ns3{
         std::set<std::string> dcnames_to_route;
         std::map<Address, int> peers_to_ASNum;
         Ipv4Address my_ip;
+        RIBShardRing rib_shards;                 // GIVEPATH goes to the shard owning the dc name
 
     protected:
         void DoDispose() override;
@@ -526,7 +1245,9 @@ namespace ns3{
         void SendUsingPath(std::vector<std::string>& path, std::string& destination_ip);
         void GetSwitch();
         void GetPath();
+        void RequestPath(const std::string& dc_name);
         void HandleSwitch(Ptr<Socket> sock);
+        void HandleMembership(const std::string& msg);
         void PledgeAllegiance();
         void HandleDCResponse(Ptr<Socket> sock);
         void HandleProberResponse(Ptr<Socket> sock);
@@ -540,12 +1261,16 @@ namespace ns3{
         uint64_t m_totalTx;    //!< Total bytes sent
         Ptr<Socket> m_socket;  //!< Socket
         Ptr<Socket> path_computer_socket;
+        Ptr<Socket> switch_sub_socket;   //!< Switch membership subscription with our RIB
+        SwitchMembership m_switchView;
         Ptr<Socket> switch_socket;
         Ptr<Socket> reply_socket;
         Ptr<Socket> switch_prober_server_socket; //!< server socket for accepting pushed packets from oswitch within domain
         Address m_peerAddress; //!< Remote peer address
         uint16_t m_peerPort;   //!< Remote peer port
         EventId m_sendEvent;   //!< Event to send the next packet
+        EventId m_subscribeEvent;              //!< Next renewal of the switch subscription
+        std::map<std::string, EventId> m_pathSendEvents; //!< DC server ip -> next send over its current path
         
         std::optional<std::pair<Ipv4Address, int64_t>> m_nearestOverlaySwitchInMyDomain;
         
@@ -555,6 +1280,96 @@ namespace ns3{
     };
 }
 
+/* Encoding of RIB snapshots: little-endian integers and u32 length-prefixed
+ * strings. The reader walks a read-only mapping of the file; running past its
+ * end fails the reader for good instead of reading garbage. */
+class SnapshotWriter {
+public:
+    void U8(uint8_t v);
+    void U32(uint32_t v);
+    void U64(uint64_t v);
+    void Bytes(const uint8_t* bytes, uint32_t len);
+    void Str(const std::string& s) { Bytes((const uint8_t*)s.data(), s.size()); }
+    const std::string& Data() const { return data; }
+
+private:
+    std::string data;
+};
+
+class SnapshotReader {
+public:
+    SnapshotReader(const uint8_t* bytes, size_t size);
+    uint8_t U8();
+    uint32_t U32();
+    uint64_t U64();
+    const uint8_t* Bytes(uint32_t& len);               // points into the mapping
+    std::string Str();
+    bool Ok() const { return ok; }
+
+private:
+    const uint8_t* Take(size_t n);
+
+    const uint8_t* pos;
+    const uint8_t* end;
+    bool ok;
+};
+
+/* Peer RIBs of a RIB. Peers sit in a vector ordered by AS number, found by AS
+ * through a dense AS-indexed array and by address through a hash map. Each peer
+ * carries its session state, including the ad outbox RIBAdStore paces (MRAI).
+ * Pointers to peers are invalidated by Add and Remove. */
+class RIBPeerTable {
+public:
+    struct PendingAd
+    {
+        uint32_t seq;
+        uint32_t pathLength;
+        Ptr<Packet> ad;
+    };
+    struct Peer
+    {
+        int as_num;
+        Address addr;                                   // address of the peer's RIB
+        Time lastHeard;                                 // last datagram to our ad store
+        uint64_t adsReceived = 0;
+        uint64_t adsSent = 0;
+
+        // Outbox of ads waiting for the advertisement interval
+        Ptr<Socket> socket;
+        std::map<std::pair<std::string, uint32_t>, PendingAd> pending;    // (name, origin AS) -> latest ad
+        std::map<std::pair<uint32_t, uint32_t>, std::pair<uint32_t, std::string>> pendingRefresh;  // (origin AS, chunk) -> (epoch, ADREFRESH)
+        EventId flushEvent;
+        Time nextAllowed;                               // end of the current advertisement interval
+    };
+
+    RIBPeerTable();
+    bool Add(int as_num, const Address& addr);         // false if nothing changed
+    bool Remove(int as_num);
+    Peer* Find(int as_num);
+    Peer* Find(const Ipv4Address& addr);
+    Peer* Find(const Address& addr);                   // Ipv4Address or InetSocketAddress
+    bool Contains(const Address& addr) { return Find(addr) != nullptr; }
+    // MemberList of (addr, AS) of every peer, the GIVEPEERS reply, rebuilt only after a change
+    const std::string& GetPeerList();
+    uint32_t GetVersion() const;                       // bumped by every change
+
+    size_t size() const { return peers.size(); }
+    bool empty() const { return peers.empty(); }
+    Peer& operator[](size_t i) { return peers[i]; }
+    std::vector<Peer>::iterator begin() { return peers.begin(); }
+    std::vector<Peer>::iterator end() { return peers.end(); }
+
+private:
+    void Reindex();
+
+    std::vector<Peer> peers;
+    std::vector<int32_t> slot_of_as;                   // AS number -> index in peers, -1 if not a peer
+    std::unordered_map<Ipv4Address, size_t, Ipv4AddressHash> slot_of_addr;
+    std::string peer_list;
+    bool peer_list_stale;
+    uint32_t version;
+};
+
 class RIB
 {
     public:
@@ -562,15 +1377,23 @@ class RIB
         Ptr<RIBLinkStateManager> linkManager;
         Ptr<RIBCertStore> certStore;
         Ptr<RIBPathComputer> pathComputer;
+        Ptr<RIBServiceQueue> serviceQueue;
         Address my_addr;
         
-        std::unordered_map<std::string, std::vector<NameDBEntry*>> *ads;
+        std::unordered_map<std::string, std::vector<NameDBEntryPtr>> *ads;
         std::set<Ipv4Address> *liveSwitches;
         std::multimap<std::string, std::pair<std::string, int>> *trustRelations;
         std::multimap<std::string, std::string> *distrustRelations;
-        std::map<int, Address> peers;
-        std::map<Address, int> peers_to_ASNum;
+        RIBPeerTable peers;
         int td_num;
+        DCNameTable names;
+
+        // Replicas of the TD's RIB split the name space between them (shards). Only the
+        // primary peers with other TDs; replicas have no peers and get the ads of the
+        // names they own, the certs and the link state from the other shards.
+        RIBShardRing shards;                     // every shard of the TD, the primary first
+        RIB *primary;                            // nullptr on the primary itself
+        std::vector<RIB *> replicas;             // set on the primary
 
         RIB(int td_num, Address myAddr, std::map<std::string, int> *addr_map);
         ~RIB();
@@ -578,6 +1401,8 @@ class RIB
         bool AddPeers(std::vector<std::pair<int, Address>> &addresses);
 
         ApplicationContainer InstallTraceRoute(const std::vector<Address>& all_ribs_, std::map<std::string, int> *addr_map);
+        void SaveState(SnapshotWriter& out);
+        bool LoadState(SnapshotReader& in);
 
         std::map<Address, int> rib_addr_map_;
     private:
@@ -587,8 +1412,16 @@ class RIB
         ns3::ObjectFactory linkManagerFactory;
         ns3::ObjectFactory certStoreFactory;
         ns3::ObjectFactory pathComputerFactory;
+        ns3::ObjectFactory serviceQueueFactory;
 };
 
+/* Converged state of every RIB (peers, ads, certs, live switches) in one
+ * versioned binary file. topology identifies the run that made it; loading
+ * into another topology fails before any RIB is touched. The trust graph is
+ * not stored, path computers rebuild it from the restored certs. */
+bool SaveRIBSnapshot(const std::string& path, const std::vector<RIB *>& ribs, uint64_t topology);
+bool LoadRIBSnapshot(const std::string& path, const std::vector<RIB *>& ribs, uint64_t topology);
+
 
 
 class OverlaySwitch
@@ -633,7 +1466,10 @@ class DCServer
 
 
 
-/* Util class reprenting a row in the advertisement store db */
+/* Util class reprenting a row in the advertisement store db.
+ * The entry itself comes from a NameDBEntryPool, but dc_name and the cert
+ * strings are 64-char hex IDs, longer than the small string buffer, so each
+ * still owns a heap allocation. */
 class NameDBEntry
 {
 public:
@@ -650,21 +1486,35 @@ public:
         std::string issuer;
     };
 
-    NameDBEntry(std::string& _dc_name, Ipv4Address& _origin_AS_addr, std::string& _td_path, Ipv4Address&  _origin_server, TrustCert _trust_cert, std::vector<DistrustCert> _distrust_cert);
+    NameDBEntry(std::string& _dc_name, Ipv4Address& _origin_AS_addr, const TdPath& _td_path, Ipv4Address&  _origin_server, TrustCert _trust_cert, std::vector<DistrustCert> _distrust_cert);
 
     ~NameDBEntry();
 
-    static NameDBEntry* FromAdvertisementStr(std::string& serialized);
+    // Both return null if the ad cannot be parsed or its path does not fit in a TdPath
+    static NameDBEntryPtr FromAdvertisementStr(std::string& serialized, NameDBEntryPool& pool);
+    static NameDBEntryPtr FromAdvertisementHeader(const AdvertisementHeader& header, NameDBEntryPool& pool);
     std::string ToAdvertisementStr();
+    AdvertisementHeader ToAdvertisementHeader();
 
     std::string dc_name;
     Ipv4Address origin_AS_addr;
-    std::vector<Ipv4Address> td_path;
+    TdPath td_path;
     Ipv4Address origin_server;
     TrustCert trust_cert;
     std::vector<DistrustCert> distrust_certs;
+    uint32_t seq = 0;                   // origin's sequence number, a newer one replaces the ad whatever its path
+    bool withdrawn = false;             // withdraws every ad of (dc_name, origin AS) up to seq
+    bool edges_retained = false;        // trust graph edges derived from this ad are held in the cert store
+    uint32_t ttl = 0;                   // seconds the ad lives without a refresh, 0 never expires
+    Time expires;
+    Time latency;                       // estimated latency to the origin AS when the ad was stored
 
-    // possibly also expire time...
-
+};
 
-};
\ No newline at end of file
+template <typename... Args>
+NameDBEntryPtr
+NameDBEntryPool::Create(Args&&... args)
+{
+    void* slot = Allocate();
+    return NameDBEntryPtr(new (slot) NameDBEntry(std::forward<Args>(args)...), NameDBEntryDeleter{this});
+}
\ No newline at end of file
@@ -0,0 +1,90 @@
+#include "main.h"
+
+static void
+PutU32(std::string& out, uint32_t v)
+{
+    out.push_back((char)(v >> 24));
+    out.push_back((char)(v >> 16));
+    out.push_back((char)(v >> 8));
+    out.push_back((char)v);
+}
+
+static uint32_t
+GetU32(const std::string& in, size_t pos)
+{
+    return ((uint32_t)(uint8_t)in[pos] << 24) | ((uint32_t)(uint8_t)in[pos + 1] << 16)
+         | ((uint32_t)(uint8_t)in[pos + 2] << 8) | (uint32_t)(uint8_t)in[pos + 3];
+}
+
+static const size_t MEMBER_LIST_HEADER = 8;
+static const size_t MEMBER_LIST_ENTRY = 8;
+
+std::string
+MemberList::Encode(uint32_t version, const Entries& entries)
+{
+    std::string out;
+    out.reserve(MEMBER_LIST_HEADER + entries.size() * MEMBER_LIST_ENTRY);
+    out.push_back((char)MEMBER_LIST_MAGIC);
+    out.push_back((char)FULL);
+    PutU32(out, version);
+    out.push_back((char)(entries.size() >> 8));
+    out.push_back((char)entries.size());
+    for (auto& entry : entries)
+    {
+        PutU32(out, entry.first.Get());
+        PutU32(out, entry.second);
+    }
+    return out;
+}
+
+std::string
+MemberList::NotModified(uint32_t version)
+{
+    std::string out;
+    out.push_back((char)MEMBER_LIST_MAGIC);
+    out.push_back((char)NOT_MODIFIED);
+    PutU32(out, version);
+    out.push_back(0);
+    out.push_back(0);
+    return out;
+}
+
+bool
+MemberList::Decode(const std::string& msg, uint32_t& version, bool& not_modified, Entries& entries)
+{
+    if (msg.size() < MEMBER_LIST_HEADER || (uint8_t)msg[0] != MEMBER_LIST_MAGIC)
+    {
+        return false;
+    }
+    version = GetU32(msg, 2);
+    not_modified = (uint8_t)msg[1] == NOT_MODIFIED;
+    size_t count = ((size_t)(uint8_t)msg[6] << 8) | (uint8_t)msg[7];
+    if (msg.size() < MEMBER_LIST_HEADER + count * MEMBER_LIST_ENTRY)
+    {
+        return false;
+    }
+    entries.clear();
+    for (size_t i = 0; i < count; i++)
+    {
+        size_t pos = MEMBER_LIST_HEADER + i * MEMBER_LIST_ENTRY;
+        entries.push_back(std::make_pair(Ipv4Address(GetU32(msg, pos)), GetU32(msg, pos + 4)));
+    }
+    return true;
+}
+
+uint32_t
+MemberList::GetVersion(const std::string& list)
+{
+    return list.size() < MEMBER_LIST_HEADER ? 0 : GetU32(list, 2);
+}
+
+bool
+MemberList::ParseSince(const std::string& request, size_t verb_len, uint32_t& since)
+{
+    if (request.size() <= verb_len + 1 || request[verb_len] != ' ')
+    {
+        return false;
+    }
+    std::istringstream iss(request.substr(verb_len + 1));
+    return (bool)(iss >> since);
+}
@@ -0,0 +1,72 @@
+#include "main.h"
+
+void
+NameDBEntryDeleter::operator()(NameDBEntry* entry) const
+{
+    pool->Release(entry);
+}
+
+NameDBEntryPool::NameDBEntryPool()
+{
+    live = 0;
+}
+
+NameDBEntryPool::~NameDBEntryPool()
+{
+    // Entries must be released before the pool goes away, see RIBAdStore::db
+    assert(live == 0);
+    for (void* slab : slabs)
+    {
+        ::operator delete(slab);
+    }
+}
+
+void*
+NameDBEntryPool::Allocate()
+{
+    if (free_slots.empty())
+    {
+        char* slab = (char*)::operator new(SLAB_SIZE * sizeof(NameDBEntry));
+        slabs.push_back(slab);
+        free_slots.reserve(SLAB_SIZE);
+        for (size_t i = SLAB_SIZE; i > 0; i--)
+        {
+            free_slots.push_back(slab + (i - 1) * sizeof(NameDBEntry));
+        }
+    }
+    void* slot = free_slots.back();
+    free_slots.pop_back();
+    live++;
+    return slot;
+}
+
+void
+NameDBEntryPool::Release(NameDBEntry* entry)
+{
+    entry->~NameDBEntry();
+    free_slots.push_back(entry);
+    live--;
+}
+
+size_t
+NameDBEntryPool::GetLiveCount() const
+{
+    return live;
+}
+
+size_t
+NameDBEntryPool::GetSlabCount() const
+{
+    return slabs.size();
+}
+
+bool
+TdPath::push_back(const Ipv4Address& addr)
+{
+    if (full())
+    {
+        return false;
+    }
+    hops[count++] = addr;
+    return true;
+}
@@ -0,0 +1,175 @@
+#include "main.h"
+
+NameTrie::NameTrie()
+{
+    count = 0;
+}
+
+size_t
+NameTrie::Size() const
+{
+    return count;
+}
+
+void
+NameTrie::Insert(const std::string& key)
+{
+    Node* node = &root;
+    size_t pos = 0;
+    while (pos < key.size())
+    {
+        auto it = node->children.find(key[pos]);
+        if (it == node->children.end())
+        {
+            auto leaf = std::make_unique<Node>();
+            leaf->label = key.substr(pos);
+            leaf->terminal = true;
+            node->children[key[pos]] = std::move(leaf);
+            count++;
+            return;
+        }
+
+        Node* child = it->second.get();
+        size_t common = 0;
+        while (common < child->label.size() && pos + common < key.size() && child->label[common] == key[pos + common])
+        {
+            common++;
+        }
+
+        if (common < child->label.size())
+        {
+            // split the edge: node -> mid(label[0, common)) -> child(label[common, ...))
+            auto mid = std::make_unique<Node>();
+            mid->label = child->label.substr(0, common);
+            std::unique_ptr<Node> old = std::move(it->second);
+            old->label = old->label.substr(common);
+            char old_first = old->label[0];
+            mid->children[old_first] = std::move(old);
+            it->second = std::move(mid);
+            child = it->second.get();
+        }
+        node = child;
+        pos += common;
+    }
+
+    if (!node->terminal)
+    {
+        node->terminal = true;
+        count++;
+    }
+}
+
+bool
+NameTrie::Contains(const std::string& key) const
+{
+    const Node* node = &root;
+    size_t pos = 0;
+    while (pos < key.size())
+    {
+        auto it = node->children.find(key[pos]);
+        if (it == node->children.end())
+        {
+            return false;
+        }
+        const std::string& label = it->second->label;
+        if (key.compare(pos, label.size(), label) != 0)
+        {
+            return false;
+        }
+        pos += label.size();
+        node = it->second.get();
+    }
+    return node->terminal;
+}
+
+/* Returns true if node is left with nothing and can be dropped by its parent */
+bool
+NameTrie::EraseFrom(Node* node, const std::string& key, size_t pos)
+{
+    if (pos == key.size())
+    {
+        node->terminal = false;
+    }
+    else
+    {
+        auto it = node->children.find(key[pos]);
+        if (it == node->children.end())
+        {
+            return false;
+        }
+        const std::string& label = it->second->label;
+        if (key.compare(pos, label.size(), label) != 0)
+        {
+            return false;
+        }
+        if (EraseFrom(it->second.get(), key, pos + label.size()))
+        {
+            node->children.erase(it);
+        }
+        else if (!it->second->terminal && it->second->children.size() == 1)
+        {
+            // merge a pass-through node into its only child to keep the trie compressed
+            std::unique_ptr<Node> only = std::move(it->second->children.begin()->second);
+            only->label = it->second->label + only->label;
+            it->second = std::move(only);
+        }
+    }
+    return !node->terminal && node->children.empty();
+}
+
+void
+NameTrie::Erase(const std::string& key)
+{
+    if (!Contains(key))
+    {
+        return;
+    }
+    EraseFrom(&root, key, 0);
+    count--;
+}
+
+void
+NameTrie::CollectAll(const Node* node, std::string& path, std::vector<std::string>& out, size_t limit)
+{
+    if (limit != 0 && out.size() >= limit)
+    {
+        return;
+    }
+    if (node->terminal)
+    {
+        out.push_back(path);
+    }
+    for (auto& child : node->children)
+    {
+        path.append(child.second->label);
+        CollectAll(child.second.get(), path, out, limit);
+        path.resize(path.size() - child.second->label.size());
+    }
+}
+
+void
+NameTrie::Collect(const std::string& prefix, std::vector<std::string>& out, size_t limit) const
+{
+    const Node* node = &root;
+    std::string path;
+    size_t pos = 0;
+    while (pos < prefix.size())
+    {
+        auto it = node->children.find(prefix[pos]);
+        if (it == node->children.end())
+        {
+            return;
+        }
+        const std::string& label = it->second->label;
+        size_t n = std::min(label.size(), prefix.size() - pos);
+        if (prefix.compare(pos, n, label, 0, n) != 0)
+        {
+            return;
+        }
+        // the prefix may end in the middle of an edge, the whole subtree still matches
+        path.append(label);
+        pos += label.size();
+        node = it->second.get();
+    }
+    CollectAll(node, path, out, limit);
+}
@@ -138,6 +138,7 @@ namespace ns3
         {
             m_socket->SetRecvCallback(MakeNullCallback<void, Ptr<Socket>>());
         }
+        Simulator::Cancel(m_renewEvent);
     }
 
 
@@ -340,6 +341,8 @@ namespace ns3
         std::string cmd = "GIVEPEERS";
         Ptr<Packet> pkt = Create<Packet>((uint8_t *)cmd.c_str(), cmd.size());
         givepeers_socket->Send(pkt);
+        // * The RIB counts the request as a heartbeat
+        ((OverlaySwitch *)parent_ctx)->pingClient->NotifyTraffic();
     }
 
     void
@@ -352,16 +355,13 @@ namespace ns3
             if (p->GetSize() > 0){
                 std::stringstream ss;
                 p->CopyData(&ss, p->GetSize());
-                std::string resp = ss.str();
-                std::istringstream iss(resp);
-                while (iss){
-                    int __td_num = -2;
-                    std::string __addr_string = "0.0.0.0";
-                    iss >> __td_num >> __addr_string;
-                    if (__addr_string == "0.0.0.0"){
-                        break;
+                uint32_t version;
+                bool not_modified;
+                MemberList::Entries entries;
+                if (MemberList::Decode(ss.str(), version, not_modified, entries)){
+                    for (auto& [addr, td] : entries){
+                        temp_peering_rib_addrs[td] = addr;
                     }
-                    temp_peering_rib_addrs[__td_num] = Ipv4Address(__addr_string.c_str());
                 }
             }
 
@@ -375,22 +375,43 @@ namespace ns3
     }
 
     // Slowly entering trailing Callback hell. Save our souls.
+    // Subscribes to the live switches of a peer TD's RIB, which pushes their changes
     void
     OverlaySwitchForwardingEngine::PopulateSwitches(int __td_num, Ipv4Address addr)
     {
-        TypeId tid = TypeId::LookupByName("ns3::UdpSocketFactory");
+        if (switch_sub_sockets.find(__td_num) == switch_sub_sockets.end()){
+            TypeId tid = TypeId::LookupByName("ns3::UdpSocketFactory");
 
-        Ptr<Socket> sock = Socket::CreateSocket(GetNode(), tid);
-        sock->Connect(
-            InetSocketAddress(Ipv4Address::ConvertFrom(addr), RIBADSTORE_PORT));
-        
-        sock->SetRecvCallback(MakeCallback(&OverlaySwitchForwardingEngine::HandleSwitchesCallback, this));
+            Ptr<Socket> sock = Socket::CreateSocket(GetNode(), tid);
+            sock->Connect(
+                InetSocketAddress(Ipv4Address::ConvertFrom(addr), RIBLSM_PORT));
 
-        giveswitches_sockets.push_back(sock);
+            sock->SetRecvCallback(MakeCallback(&OverlaySwitchForwardingEngine::HandleSwitchesCallback, this));
 
-        std::string cmd = "GIVESWITCHES";
+            switch_sub_sockets[__td_num] = sock;
+        }
+
+        SubscribeSwitches(__td_num);
+        if (!m_renewEvent.IsRunning()){
+            m_renewEvent = Simulator::Schedule(Seconds(SWITCH_SUB_RENEW_SECONDS), &OverlaySwitchForwardingEngine::RenewSubscriptions, this);
+        }
+    }
+
+    void
+    OverlaySwitchForwardingEngine::SubscribeSwitches(int __td_num)
+    {
+        std::string cmd = switch_views[__td_num].SubscribeRequest();
         Ptr<Packet> p = Create<Packet>((uint8_t *)cmd.c_str(), cmd.size());
-        sock->Send(p);
+        switch_sub_sockets[__td_num]->Send(p);
+    }
+
+    void
+    OverlaySwitchForwardingEngine::RenewSubscriptions()
+    {
+        m_renewEvent = Simulator::Schedule(Seconds(SWITCH_SUB_RENEW_SECONDS), &OverlaySwitchForwardingEngine::RenewSubscriptions, this);
+        for (auto &x: switch_sub_sockets){
+            SubscribeSwitches(x.first);
+        }
     }
 
     void
@@ -400,7 +421,7 @@ namespace ns3
         Ptr<Packet> p;
         while (p = sock->RecvFrom(from)){
             Ipv4Address __from = InetSocketAddress::ConvertFrom(from).GetIpv4();
-            NS_LOG_INFO("Received GIVESWITCHES Response from: " << __from << " Size: " << p->GetSize());
+            NS_LOG_INFO("Received switch membership from: " << __from << " Size: " << p->GetSize());
             int __td_num = -1;
             for (auto &x: temp_peering_rib_addrs){
                 if (x.second == __from){
@@ -418,28 +439,25 @@ namespace ns3
                 p->CopyData(&ss, p->GetSize());
                 std::string resp = ss.str();
 
-                NS_LOG_INFO("GIVESWITCHES Response: " << resp);
-                
-                std::istringstream iss(resp);
-                std::set<Address> addr_set;
-
-                while (iss){
-                    std::string addr_str = "0.0.0.0";
-                    iss >> addr_str;
-                    if (addr_str == "0.0.0.0"){
-                        break;
-                    }
+                NS_LOG_INFO("Switch membership push: " << resp);
+                if (!SwitchMembership::IsPush(resp)){
+                    continue;
+                }
 
-                    Ipv4Address addr(addr_str.c_str());
-                    addr_set.insert(addr);
+                std::vector<Ipv4Address> added;
+                std::vector<Ipv4Address> removed;
+                if (!switch_views[__td_num].Apply(resp, added, removed)){
+                    // * Missed a delta, get the whole set again
+                    SubscribeSwitches(__td_num);
+                    continue;
                 }
 
-                if (oswitch_in_other_td.find(__td_num) == oswitch_in_other_td.end()){
-                    oswitch_in_other_td[__td_num] = addr_set;
-                }else{
-                    for (auto &a: addr_set){
-                        oswitch_in_other_td[__td_num].insert(a);
-                    }
+                std::set<Address>& addr_set = oswitch_in_other_td[__td_num];
+                for (auto &a: removed){
+                    addr_set.erase(a);
+                }
+                for (auto &a: added){
+                    addr_set.insert(a);
                 }
 
                 NS_LOG_INFO("OSwitch in TD: " << td_num << " Other TDs included: " << oswitch_in_other_td.size());
@@ -21,10 +21,16 @@ namespace ns3
                             MakeUintegerAccessor(&OverlaySwitchPingClient::m_count),
                             MakeUintegerChecker<uint32_t>())
                 .AddAttribute("Interval",
-                            "The time to wait between packets",
+                            "The time to wait between packets, the heartbeat interval after (re)joining",
                             TimeValue(Seconds(1.0)),
                             MakeTimeAccessor(&OverlaySwitchPingClient::m_interval),
                             MakeTimeChecker())
+                .AddAttribute("MaxInterval",
+                            "The heartbeat interval doubles after every heartbeat up to this while the RIB "
+                            "keeps us live. Bounds failure detection at the RIB.",
+                            TimeValue(Seconds(8.0)),
+                            MakeTimeAccessor(&OverlaySwitchPingClient::m_maxInterval),
+                            MakeTimeChecker())
                 .AddAttribute("RemoteAddress",
                             "The destination Address of the outbound packets",
                             AddressValue(),
@@ -48,6 +54,8 @@ namespace ns3
     {
         NS_LOG_FUNCTION(this);
         m_sent = 0;
+        m_suppressed = 0;
+        m_backingOff = false;
         m_totalTx = 0;
         m_socket = nullptr;
         m_sendEvent = EventId();
@@ -150,11 +158,41 @@ namespace ns3
         m_peerAddressString = peerAddressStringStream.str();
     #endif // NS3_LOG_ENABLE
 
-        m_socket->SetRecvCallback(MakeNullCallback<void, Ptr<Socket>>());
+        m_socket->SetRecvCallback(MakeCallback(&OverlaySwitchPingClient::HandleRead, this));
         m_socket->SetAllowBroadcast(true);
+        m_currentInterval = m_interval;
+        m_backingOff = false;
         m_sendEvent = Simulator::Schedule(Seconds(1.0), &OverlaySwitchPingClient::Send, this);
     }
 
+    // Other traffic of this switch to its RIB's link-state port, the RIB takes it
+    // as a heartbeat too. Only GIVEPEERS goes there today.
+    void
+    OverlaySwitchPingClient::NotifyTraffic()
+    {
+        m_lastTraffic = Simulator::Now();
+    }
+
+    // "HBRESET": the RIB did not have us live, heartbeat at the base interval again.
+    // The heartbeat it answers already made us live, so the next one keeps its slot.
+    void
+    OverlaySwitchPingClient::HandleRead(Ptr<Socket> socket)
+    {
+        Ptr<Packet> packet;
+        while ((packet = socket->Recv()))
+        {
+            std::stringstream ss;
+            packet->CopyData(&ss, packet->GetSize());
+            if (ss.str() == "HBRESET" && m_currentInterval != m_interval)
+            {
+                m_currentInterval = m_interval;
+                m_backingOff = false;
+                Simulator::Cancel(m_sendEvent);
+                m_sendEvent = Simulator::Schedule(m_interval, &OverlaySwitchPingClient::Send, this);
+            }
+        }
+    }
+
     void
     OverlaySwitchPingClient::StopApplication()
     {
@@ -162,16 +200,39 @@ namespace ns3
         Simulator::Cancel(m_sendEvent);
     }
 
+    /* Heartbeat: SeqTs header, then the interval to the next one in ms (text).
+     * The interval doubles while the RIB keeps us live, up to MaxInterval; the
+     * first heartbeat after start or HBRESET announces the base interval, so
+     * the RIB taking us up does not reset a backoff that never started. A
+     * heartbeat is skipped if other traffic reached the RIB within the interval,
+     * the next one is due an interval after that traffic. */
     void
     OverlaySwitchPingClient::Send()
     {
         NS_LOG_FUNCTION(this);
         NS_ASSERT(m_sendEvent.IsExpired());
 
+        Time now = Simulator::Now();
+        if (m_lastTraffic > m_lastHeartbeat && now - m_lastTraffic < m_currentInterval)
+        {
+            ++m_suppressed;
+            m_sendEvent = Simulator::Schedule(m_lastTraffic + m_currentInterval - now, &OverlaySwitchPingClient::Send, this);
+            return;
+        }
+
+        // announce the next interval before going to it, the RIB must never expect us sooner
+        if (m_backingOff)
+        {
+            m_currentInterval = std::min(m_currentInterval * (int64_t)2, m_maxInterval);
+        }
+        m_backingOff = true;
+        std::string next = std::to_string(m_currentInterval.GetMilliSeconds());
+
         SeqTsHeader seqTs;
         seqTs.SetSeq(m_sent);
-        Ptr<Packet> p = Create<Packet>(0); // 8+4 : the size of the seqTs header
+        Ptr<Packet> p = Create<Packet>((const uint8_t *)next.c_str(), next.size());
         p->AddHeader(seqTs);
+        m_lastHeartbeat = now;
 
         if ((m_socket->Send(p)) >= 0)
         {
@@ -190,7 +251,13 @@ namespace ns3
     #endif // NS3_LOG_ENABLE
 
 
-        m_sendEvent = Simulator::Schedule(m_interval, &OverlaySwitchPingClient::Send, this);
+        m_sendEvent = Simulator::Schedule(m_currentInterval, &OverlaySwitchPingClient::Send, this);
+    }
+
+    uint64_t
+    OverlaySwitchPingClient::GetSuppressed() const
+    {
+        return m_suppressed;
     }
 
     uint64_t
@@ -9,6 +9,7 @@ RIB::RIB(int td_num_, Address myAddr, std::map<std::string, int> *addr_map)
     my_addr = myAddr;
     addr_map_ = addr_map;
     td_num = td_num_;
+    primary = nullptr;
 }
 
 RIB::~RIB()
@@ -19,6 +20,9 @@ RIB::~RIB()
 ApplicationContainer RIB::Install(Ptr<Node> node)
 {
     my_node = node;
+    serviceQueueFactory.SetTypeId(RIBServiceQueue::GetTypeId());
+    serviceQueue = serviceQueueFactory.Create<RIBServiceQueue>();
+
     adStoreFactory.SetTypeId(RIBAdStore::GetTypeId());
     adStore = adStoreFactory.Create<RIBAdStore>();
     adStore->SetAttribute("Port", UintegerValue(RIBADSTORE_PORT));
@@ -61,7 +65,7 @@ bool RIB::AddPeers(std::vector<std::pair<int, Address>> &addresses)
 {
     for (auto a = addresses.begin(); a != addresses.end(); a++) 
     {
-        peers[a->first] = a->second; // copy and create new address instance
+        peers.Add(a->first, a->second);
     }
 
     return true;
@@ -90,3 +94,86 @@ ApplicationContainer RIB::InstallTraceRoute(const std::vector<Address>& all_ribs
 
     return trApps;
 }
+
+/* Snapshot of this RIB: identity, peers, AS map, live switches, then the cert
+ * store and the ad store. Certs go first so restored ads find their owner certs.
+ * A primary is followed by its replicas. */
+void RIB::SaveState(SnapshotWriter& out)
+{
+    out.U32(td_num);
+    out.U32(Ipv4Address::ConvertFrom(my_addr).Get());
+
+    out.U32(peers.size());
+    for (auto& peer : peers)
+    {
+        out.U32(peer.as_num);
+        out.U32(Ipv4Address::ConvertFrom(peer.addr).Get());
+    }
+
+    out.U32(rib_addr_map_.size());
+    for (auto& x : rib_addr_map_)
+    {
+        out.U32(Ipv4Address::ConvertFrom(x.first).Get());
+        out.U32(x.second);
+    }
+
+    out.U32(linkManager->liveSwitches.size());
+    for (auto& addr : linkManager->liveSwitches)
+    {
+        out.U32(addr.Get());
+    }
+
+    certStore->SaveState(out);
+    adStore->SaveState(out);
+
+    for (RIB *replica : replicas)
+    {
+        replica->SaveState(out);
+    }
+}
+
+bool RIB::LoadState(SnapshotReader& in)
+{
+    if (in.U32() != (uint32_t)td_num || in.U32() != Ipv4Address::ConvertFrom(my_addr).Get())
+    {
+        return false;
+    }
+
+    uint32_t count = in.U32();
+    for (uint32_t i = 0; i < count && in.Ok(); i++)
+    {
+        int as = in.U32();
+        Address addr = Ipv4Address(in.U32());
+        peers.Add(as, addr);
+        // what traceroute would have set up
+        global_addr_to_AS[addr] = as;
+        global_AS_to_addr[as] = addr;
+    }
+
+    count = in.U32();
+    for (uint32_t i = 0; i < count && in.Ok(); i++)
+    {
+        Address addr = Ipv4Address(in.U32());
+        rib_addr_map_[addr] = in.U32();
+    }
+
+    count = in.U32();
+    for (uint32_t i = 0; i < count && in.Ok(); i++)
+    {
+        linkManager->liveSwitches.insert(Ipv4Address(in.U32()));
+    }
+
+    if (!in.Ok() || !certStore->LoadState(in) || !adStore->LoadState(in))
+    {
+        return false;
+    }
+
+    for (RIB *replica : replicas)
+    {
+        if (!replica->LoadState(in))
+        {
+            return false;
+        }
+    }
+    return true;
+}
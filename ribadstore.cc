@@ -28,6 +28,114 @@ namespace ns3
                             MakeUintegerAccessor(&RIBAdStore::GetPacketWindowSize,
                                                 &RIBAdStore::SetPacketWindowSize),
                             MakeUintegerChecker<uint16_t>(8, 256))
+                .AddAttribute("BinaryAds",
+                            "Forward advertisements to peer RIBs in the binary encoding instead of JSON. "
+                            "Both encodings are always accepted.",
+                            BooleanValue(true),
+                            MakeBooleanAccessor(&RIBAdStore::m_binaryAds),
+                            MakeBooleanChecker())
+                .AddAttribute("BatchMtu",
+                            "Maximum size of a datagram of batched ads sent to one peer. "
+                            "0 sends every ad in its own datagram.",
+                            UintegerValue(1400),
+                            MakeUintegerAccessor(&RIBAdStore::m_batchMtu),
+                            MakeUintegerChecker<uint32_t>())
+                .AddAttribute("MinAdvertisementInterval",
+                            "Per-peer advertisement interval (MRAI): after ads are flushed to a peer, "
+                            "the next flush waits 75-100% of this, randomly.",
+                            TimeValue(Seconds(1)),
+                            MakeTimeAccessor(&RIBAdStore::m_mrai),
+                            MakeTimeChecker())
+                .AddAttribute("BatchFlushInterval",
+                            "How long ads to an idle peer wait for more ads before being flushed.",
+                            TimeValue(MilliSeconds(50)),
+                            MakeTimeAccessor(&RIBAdStore::m_batchFlushInterval),
+                            MakeTimeChecker())
+                .AddAttribute("SeenCacheSize",
+                            "Number of binary ad digests remembered to drop flooded duplicates "
+                            "before they are parsed. 0 disables the cache.",
+                            UintegerValue(4096),
+                            MakeUintegerAccessor(&RIBAdStore::GetSeenCacheSize,
+                                                &RIBAdStore::SetSeenCacheSize),
+                            MakeUintegerChecker<uint32_t>())
+                .AddAttribute("CoalesceWindow",
+                            "How long a GIVESWITCHES/GIVEADS query waits for identical queries "
+                            "before one answer is computed for all of them. Zero still merges "
+                            "queries that arrive within the same simulation instant.",
+                            TimeValue(Seconds(0)),
+                            MakeTimeAccessor(&RIBAdStore::m_coalesceWindow),
+                            MakeTimeChecker())
+                .AddAttribute("ResponseMtu",
+                            "Maximum size of one datagram of a streamed prefix GIVEADS reply.",
+                            UintegerValue(1400),
+                            MakeUintegerAccessor(&RIBAdStore::m_responseMtu),
+                            MakeUintegerChecker<uint32_t>(64))
+                .AddAttribute("RankBy",
+                            "How the origins of a name are ordered in GIVEADS replies: by TD path "
+                            "length or by the estimated latency to the origin AS.",
+                            EnumValue(RIBAdStore::RANK_PATH_LENGTH),
+                            MakeEnumAccessor(&RIBAdStore::m_rankBy),
+                            MakeEnumChecker(RIBAdStore::RANK_PATH_LENGTH, "PathLength",
+                                            RIBAdStore::RANK_LATENCY, "Latency"))
+                .AddAttribute("DisseminationMode",
+                            "How updated ads are passed on to peer RIBs.",
+                            EnumValue(RIBAdStore::DISSEMINATE_FLOOD),
+                            MakeEnumAccessor(&RIBAdStore::m_dissemination),
+                            MakeEnumChecker(RIBAdStore::DISSEMINATE_FLOOD, "Flood",
+                                            RIBAdStore::DISSEMINATE_GOSSIP, "Gossip"))
+                .AddAttribute("GossipFanout",
+                            "Number of random peers an updated ad is pushed to in gossip mode.",
+                            UintegerValue(3),
+                            MakeUintegerAccessor(&RIBAdStore::m_gossipFanout),
+                            MakeUintegerChecker<uint32_t>(1))
+                .AddAttribute("GossipInterval",
+                            "Time between pull rounds in gossip mode, each with one random peer. "
+                            "Zero disables pulls.",
+                            TimeValue(Seconds(1)),
+                            MakeTimeAccessor(&RIBAdStore::m_gossipInterval),
+                            MakeTimeChecker())
+                .AddAttribute("ExpiryGranularity",
+                            "Tick of the timer wheel that expires ads whose TTL ran out without a refresh.",
+                            TimeValue(Seconds(1)),
+                            MakeTimeAccessor(&RIBAdStore::m_expiryGranularity),
+                            MakeTimeChecker())
+                .AddAttribute("SummaryMode",
+                            "Flood counting Bloom summaries of each origin's names instead of the ads; "
+                            "ads are then fetched towards their origin when a client asks for them.",
+                            BooleanValue(false),
+                            MakeBooleanAccessor(&RIBAdStore::m_summaryMode),
+                            MakeBooleanChecker())
+                .AddAttribute("SummaryBits",
+                            "Number of bits of a name summary.",
+                            UintegerValue(4096),
+                            MakeUintegerAccessor(&RIBAdStore::m_summaryBits),
+                            MakeUintegerChecker<uint32_t>(8))
+                .AddAttribute("SummaryHashes",
+                            "Number of hash functions of a name summary.",
+                            UintegerValue(4),
+                            MakeUintegerAccessor(&RIBAdStore::m_summaryHashes),
+                            MakeUintegerChecker<uint32_t>(1, 16))
+                .AddAttribute("ResolveTimeout",
+                            "How long a GIVEADS query waits for an ad fetched from its origin in summary mode.",
+                            TimeValue(MilliSeconds(500)),
+                            MakeTimeAccessor(&RIBAdStore::m_resolveTimeout),
+                            MakeTimeChecker())
+                .AddTraceSource("QueryCoalesced",
+                                "A query joined an identical query that is already being answered",
+                                MakeTraceSourceAccessor(&RIBAdStore::m_queryCoalescedTrace),
+                                "ns3::QueryFlights::TracedCallback")
+                .AddTraceSource("QueryAnswered",
+                                "A query was answered, with the number of requesters served",
+                                MakeTraceSourceAccessor(&RIBAdStore::m_queryAnsweredTrace),
+                                "ns3::QueryFlights::TracedCallback")
+                .AddTraceSource("Expired",
+                                "An ad expired, with its name and origin AS",
+                                MakeTraceSourceAccessor(&RIBAdStore::m_expiredTrace),
+                                "ns3::RIBAdStore::ExpiredCallback")
+                .AddTraceSource("DuplicateAd",
+                                "A binary ad was dropped by the seen-cache without being parsed",
+                                MakeTraceSourceAccessor(&RIBAdStore::m_duplicateAdTrace),
+                                "ns3::Packet::TracedCallback")
                 .AddTraceSource("Rx",
                                 "A packet has been received",
                                 MakeTraceSourceAccessor(&RIBAdStore::m_rxTrace),
@@ -44,6 +152,10 @@ namespace ns3
     {
         NS_LOG_FUNCTION(this);
         m_received = 0;
+        m_rng = CreateObject<UniformRandomVariable>();
+        m_summaryVersion = 0;
+        m_refreshEpoch = 0;
+        m_stats = DisseminationStats{0, 0, 0, Seconds(0)};
         // parent_ctx = ctx;
     }
 
@@ -71,6 +183,18 @@ namespace ns3
         m_lossCounter.SetBitMapSize(size);
     }
 
+    uint32_t
+    RIBAdStore::GetSeenCacheSize() const
+    {
+        return m_seenCache.GetCapacity();
+    }
+
+    void
+    RIBAdStore::SetSeenCacheSize(uint32_t size)
+    {
+        m_seenCache.SetCapacity(size);
+    }
+
     uint32_t
     RIBAdStore::GetLost() const
     {
@@ -95,8 +219,8 @@ namespace ns3
         my_addr.Print(ss);
         std::string my_addr_str = ss.str();
 
-        for (auto pair : this->db) {
-            for (auto entry_ptr : pair.second) {
+        for (auto& pair : this->db) {
+            for (auto& entry_ptr : pair.second) {
                 std::stringstream td_path_str;
                 for (Ipv4Address addr : entry_ptr->td_path) {
                     std::stringstream ss;
@@ -105,7 +229,7 @@ namespace ns3
                 }
                 std::string result = td_path_str.str();
                 std::string result_trim = result.substr(0, result.size()-2);
-                NS_LOG_INFO("RibStore "<<my_addr_str<<"'s ads store has"<< "\n" <<" Name:" << pair.first << "\n" << "Entry: " << result_trim << "\n");
+                NS_LOG_INFO("RibStore "<<my_addr_str<<"'s ads store has"<< "\n" <<" Name:" << rib->names.GetLabel(pair.first) << "\n" << "Entry: " << result_trim << "\n");
             }
         }
 
@@ -145,10 +269,28 @@ namespace ns3
 
         m_socket6->SetRecvCallback(MakeCallback(&RIBAdStore::HandleRead, this));
 
+        m_localSummary.Reset(m_summaryBits, m_summaryHashes);
+        m_expiry.Configure(m_expiryGranularity, 64);
+        m_expiryEvent = Simulator::Schedule(m_expiryGranularity, &RIBAdStore::ExpiryTick, this);
+        // * Ads restored from a snapshot are already in db
+        RIB *rib = (RIB *)(this->parent_ctx);
+        for (auto& pair : db) {
+            for (auto& entry : pair.second) {
+                if (entry->ttl != 0) {
+                    m_expiry.Schedule(std::make_pair(entry->dc_name, entry->origin_AS_addr.Get()), entry->expires);
+                }
+                if (m_summaryMode && entry->origin_AS_addr == rib->my_addr) {
+                    AddToSummary(pair.first);
+                }
+            }
+        }
+        if (m_dissemination == DISSEMINATE_GOSSIP && !m_summaryMode && !m_gossipInterval.IsZero()) {
+            m_pullEvent = Simulator::Schedule(m_gossipInterval * m_rng->GetValue(0.5, 1.0), &RIBAdStore::PullRound, this);
+        }
+
         Simulator::Schedule(Seconds(13.0), [this]{
-            std::map<int, Address>& addr = ((RIB *)this->parent_ctx)->peers;
-            for (auto& [AS_num, a] : addr) {
-                NS_LOG_INFO(">> I am " << Ipv4Address::ConvertFrom(((RIB *)this->parent_ctx)->my_addr) << "peer: " << Ipv4Address::ConvertFrom(a));
+            for (auto& peer : ((RIB *)this->parent_ctx)->peers) {
+                NS_LOG_INFO(">> I am " << Ipv4Address::ConvertFrom(((RIB *)this->parent_ctx)->my_addr) << "peer: " << Ipv4Address::ConvertFrom(peer.addr));
             }
             });
 
@@ -158,6 +300,18 @@ namespace ns3
     RIBAdStore::StopApplication()
     {
         NS_LOG_FUNCTION(this);
+        for (auto& peer : ((RIB *)this->parent_ctx)->peers) {
+            Simulator::Cancel(peer.flushEvent);
+            peer.pending.clear();
+        }
+        Simulator::Cancel(m_summaryEvent);
+        Simulator::Cancel(m_pullEvent);
+        Simulator::Cancel(m_expiryEvent);
+        Simulator::Cancel(m_refreshEvent);
+        for (auto& x : m_resolving) {
+            Simulator::Cancel(x.second);
+        }
+        m_resolving.clear();
 
         if (m_socket)
         {
@@ -165,68 +319,244 @@ namespace ns3
         }
     }
 
-    void
-    RIBAdStore::SendOverlaySwitches(Ptr<Socket> socket, Address dest)
+    Ptr<Packet>
+    RIBAdStore::BuildOverlaySwitchesResponse()
     {
         RIB *rib = (RIB *)(this->parent_ctx); // * parent context is the RIB helper class
-        std::cout << "Live switches: " << rib->liveSwitches->size() << std::endl;
-        std::stringstream ss;
-        for (auto x = rib->liveSwitches->begin(); x != rib->liveSwitches->end(); x++){
-            ss << *x << " ";
+        // * Encoded once per membership change by the link-state manager
+        const std::string& resp = rib->linkManager->GetSwitchList();
+
+        NS_LOG_INFO("Sending GIVESWITCHES response, " << rib->liveSwitches->size() << " switches");
+        return Create<Packet>((const uint8_t *)resp.data(), resp.size());
+    }
+
+    /* Name an ad is indexed under: the owner-qualified name ("owner:ID") once an
+     * owner's trust cert for it is attached, the bare DC name otherwise. */
+    std::string
+    RIBAdStore::QualifiedName(const NameDBEntry& entry)
+    {
+        const std::string& issuer = entry.trust_cert.issuer;
+        const std::string& name = entry.dc_name;
+        if (issuer.size() > name.size() && issuer[issuer.size() - name.size() - 1] == ':'
+            && issuer.compare(issuer.size() - name.size(), name.size(), name) == 0) {
+            return issuer;
+        }
+        return name;
+    }
+
+    /* Stored ads indexed under key. Index keys are dropped lazily here once no ad
+     * carries them any more (entry replaced by one from another owner). */
+    std::vector<NameDBEntry*>
+    RIBAdStore::ResolveQualifiedName(const std::string& key)
+    {
+        std::vector<NameDBEntry*> found;
+        // aggregated ads are stored under "owner:*" itself
+        size_t colon = key.rfind(':');
+        auto it = db.find(key);
+        if (it == db.end() && colon != std::string::npos) {
+            it = db.find(key.substr(colon + 1));
+        }
+        if (it != db.end()) {
+            for (auto& entry : it->second) {
+                if (QualifiedName(*entry) == key) {
+                    found.push_back(entry.get());
+                }
+            }
+        }
+        if (found.empty()) {
+            m_nameIndex.Erase(key);
         }
-        std::string resp = ss.str();
+        return found;
+    }
+
+    /* "GIVEADS <name>" answers with every origin of the name, best ranked first (see
+     * RankBy): one "ad:" datagram if there is a single origin, else "ads:<i>/<n>\n"
+     * datagrams of newline separated ads. <name> is either the bare DC name or
+     * "owner:name", which picks the ads of that owner's origins, or else the owner's
+     * aggregated "owner:*" ad. Replies for bare names are kept until db changes.
+     * "GIVEADS <prefix>*" streams every matching ad the same way, each datagram at
+     * most ResponseMtu bytes. */
+    std::vector<Ptr<Packet>>
+    RIBAdStore::BuildClientsResponse(std::string name)
+    {
+        std::vector<Ptr<Packet>> packets;
+        NS_LOG_INFO("sent to client the advertisement of " << name);
+
+        std::vector<std::string> replies;
+        if (name.empty() || name.back() != '*') {
+            auto cached = m_rankedAds.find(name);
+            auto it = db.find(name);
+            if (cached != m_rankedAds.end()) {
+                replies = cached->second;
+            } else if (it != db.end() && it->second.size() != 0) {
+                std::vector<NameDBEntry*> ranked;
+                for (auto& entry : it->second) {
+                    ranked.push_back(entry.get());
+                }
+                replies = PackAds(ranked, false);
+                m_rankedAds[name] = replies;
+            } else {
+                std::vector<NameDBEntry*> found = ResolveQualifiedName(name);
+                // * No exact ad: fall back to the aggregate of the owner's prefix
+                size_t colon = name.find(":");
+                if (found.empty() && colon != std::string::npos) {
+                    found = ResolveQualifiedName(name.substr(0, colon) + ":*");
+                }
+                replies = PackAds(found, false);
+            }
+            if (replies.empty()) {
+                NS_LOG_ERROR("Cannot find local advertisement of the name: " << name);
+            }
+        } else {
+            std::vector<std::string> keys;
+            m_nameIndex.Collect(name.substr(0, name.size() - 1), keys);
+
+            std::vector<NameDBEntry*> matching;
+            for (auto& key : keys) {
+                for (NameDBEntry* entry : ResolveQualifiedName(key)) {
+                    matching.push_back(entry);
+                }
+            }
+            replies = PackAds(matching, true);
+            if (replies.empty()) {
+                NS_LOG_ERROR("Cannot find local advertisements under the prefix: " << name);
+            }
+        }
+
+        for (auto& str_repr : replies) {
+            packets.push_back(Create<Packet>((const uint8_t *)str_repr.c_str(), str_repr.size()));
+        }
+        return packets;
+    }
 
-        NS_LOG_INFO("Sending GIVESWITCHES response: " << resp);
-        Ptr<Packet> p = Create<Packet>((const uint8_t *)resp.c_str(), resp.size());
-        NS_LOG_INFO("Send status: " << socket->SendTo(p, 0, dest));
+    std::vector<std::string>
+    RIBAdStore::PackAds(const std::vector<NameDBEntry*>& entries, bool stream)
+    {
+        std::vector<std::string> replies;
+        if (entries.size() == 1 && !stream) {
+            replies.push_back("ad:" + entries[0]->ToAdvertisementStr());
+            return replies;
+        }
+
+        std::vector<std::string> bodies;
+        std::string body;
+        for (NameDBEntry* entry : entries) {
+            std::string ad = entry->ToAdvertisementStr();
+            // "ads:65535/65535\n" header plus the ad's trailing newline
+            if (!body.empty() && body.size() + ad.size() + 16 > m_responseMtu) {
+                bodies.push_back(body);
+                body.clear();
+            }
+            body += ad;
+            if (body.back() != '\n') {
+                body += '\n';
+            }
+        }
+        if (!body.empty()) {
+            bodies.push_back(body);
+        }
+
+        for (size_t i = 0; i < bodies.size(); i++) {
+            std::stringstream ss;
+            ss << "ads:" << i << "/" << bodies.size() << "\n" << bodies[i];
+            replies.push_back(ss.str());
+        }
+        return replies;
     }
 
+    /* Identical queries (same key) that arrive before the first one is answered
+     * share its answer: only the first requester schedules AnswerQuery. */
     void
-    RIBAdStore::SendClients(Ptr<Socket> socket, Address dest, std::string name) 
+    RIBAdStore::HandleQuery(Ptr<Socket> socket, Address from, std::string key)
     {
-        NS_LOG_INFO("sent to client the advertisement of " << name); 
-        auto it = db.find(name);
-        
-        if (it == db.end() || it->second.size() == 0) {
-            NS_LOG_ERROR("Cannot find local advertisement of the name: " << name);
+        if (!m_flights.Join(key, socket, from)) {
+            m_queryCoalescedTrace(key, m_flights.GetWaiting(key));
             return;
         }
-        // TODO: to distinguish which advertisement to send. They could have different origin AS. Currently using the 1st one found
-        std::string str_repr = "ad:" + (it->second[0]->ToAdvertisementStr());
-        Ptr<Packet> p = Create<Packet>((const uint8_t *)str_repr.c_str(), str_repr.size());
-        NS_LOG_INFO("Send to client " << socket->SendTo(p, 0, dest));
+        Simulator::Schedule(m_coalesceWindow, &RIBAdStore::SubmitQuery, this, key);
+    }
+
+    void
+    RIBAdStore::SubmitQuery(std::string key)
+    {
+        RIB *rib = (RIB *)(this->parent_ctx);
+        RIBServiceQueue::Opcode op = key == "GIVESWITCHES" ? RIBServiceQueue::OP_GIVESWITCHES : RIBServiceQueue::OP_GIVEADS;
+        // * Joiners keep attaching to the flight while it waits in the queue
+        if (!rib->serviceQueue->Submit(op, [this, key]() { AnswerQuery(key); })) {
+            m_queryAnsweredTrace(key, m_flights.Complete(key, rib->serviceQueue->GetShedReply(op)).size());
+        }
     }
 
+    void
+    RIBAdStore::AnswerQuery(std::string key)
+    {
+        std::vector<Address> requesters;
+        if (key == "GIVESWITCHES") {
+            requesters = m_flights.Complete(key, BuildOverlaySwitchesResponse());
+        } else {
+            // Packet Format is "GIVEADS [dc name]", thus start from index 8
+            std::vector<Ptr<Packet>> response = BuildClientsResponse(key.substr(8));
+            auto resolving = m_resolving.find(key);
+            if (resolving != m_resolving.end()) {
+                Simulator::Cancel(resolving->second);
+                m_resolving.erase(resolving);
+            } else if (response.empty() && m_summaryMode && ResolveName(key.substr(8))) {
+                // * Answered again once the ad arrives, or with whatever we have after ResolveTimeout
+                m_resolving[key] = Simulator::Schedule(m_resolveTimeout, &RIBAdStore::AnswerQuery, this, key);
+                return;
+            }
+            requesters = m_flights.Complete(key, response);
+        }
+        NS_LOG_INFO("Answered " << key << " for " << requesters.size() << " requester(s)");
+        m_queryAnsweredTrace(key, requesters.size());
+    }
 
-    /* Return true if the provided entry is in db, false if table not updated */
+
+    /* Return true if the provided entry is in db, false if table not updated.
+     * Per origin, a newer sequence number always wins; among ads with the same
+     * one the shorter path does. Ads not newer than a withdrawal are stale. */
     bool
-    RIBAdStore::UpdateNameCache(NameDBEntry* advertised)
+    RIBAdStore::UpdateNameCache(NameDBEntryPtr advertised)
     {
         bool updated = false;
 
-        std::string& dc_name = advertised->dc_name;
+        RIB *rib = (RIB *)(this->parent_ctx); // * parent context is the RIB class
+        // interned: stays valid after advertised is moved into db below
+        const std::string& dc_name = rib->names.Intern(advertised->dc_name);
+        NameDBEntry* entry = advertised.get();
         
         Ipv4Address origin_AS_addr = advertised->origin_AS_addr;
 
-        RIB *rib = (RIB *)(this->parent_ctx); // * parent context is the RIB class
-        // store ads if
-        //   1. origin address is current rib's address
-        //   2. no existing entry in db
-        if (origin_AS_addr == rib->my_addr || db.find(dc_name) == db.end()) {
-            db[dc_name] = std::vector<NameDBEntry*>{ advertised };
+        auto withdrawn = m_withdrawn.find(std::make_pair(dc_name, origin_AS_addr.Get()));
+        if (withdrawn != m_withdrawn.end()) {
+            if (advertised->seq <= withdrawn->second) {
+                NS_LOG_INFO("Ignoring ad of " << dc_name << " older than its withdrawal");
+                return false;
+            }
+            m_withdrawn.erase(withdrawn);
+        }
+
+        // * Our own ads are one origin among the others: they replace only our previous one
+        // (they are numbered on arrival, so always newer), never the other replicas
+        if (db.find(dc_name) == db.end()) {
+            db[dc_name].push_back(std::move(advertised));
+            m_rankedAds.erase(dc_name);
             updated = true;
         } else {
             // check if advertisement from this origin AS already exist
-            std::vector<NameDBEntry*>& all_ads = db[dc_name];
+            std::vector<NameDBEntryPtr>& all_ads = db[dc_name];
             bool already_exist = false;
             for (auto ad = all_ads.begin(); ad != all_ads.end(); ++ad) {
-                // if it does, update to have shorter path if possible
+                // if it does, update if newer or to have shorter path if possible
                 if ((*ad)->origin_AS_addr == advertised->origin_AS_addr) {
                     already_exist = true;
 
-                    if ((*ad)->td_path.size() > advertised->td_path.size()) {
-                        delete all_ads[ad-all_ads.begin()];
-                        all_ads[ad-all_ads.begin()] = advertised;
+                    if (advertised->seq > (*ad)->seq
+                        || (advertised->seq == (*ad)->seq && (*ad)->td_path.size() > advertised->td_path.size())) {
+                        ReleaseAdEdges(ad->get());
+                        UnindexAd(ad->get());
+                        all_ads.erase(ad);
+                        InsertRanked(all_ads, std::move(advertised));
                         updated = true;
                     }
 
@@ -236,289 +566,1623 @@ namespace ns3
 
             // add to the advertisement vector for this dc name if not seen before
             if (!already_exist) {
-                all_ads.push_back(advertised);
+                InsertRanked(all_ads, std::move(advertised));
                 updated = true;
             }
-                
+            if (updated) {
+                m_rankedAds.erase(dc_name);
+            }
         }
 
+        if (updated) {
+            IndexAd(entry);
+            ShareWithShard(dc_name);
+        }
         return updated;
     }
 
-    void
-    RIBAdStore::ForwardAds(Ptr<Socket> socket, std::string& content, Address dest) {
-        // Need to add header because the same type of header is alwasy striped down on the HandleRead() side
-        SeqTsHeader seqTS;  //! not initialized, do we care sequence number and timestamp?
-        Ptr<Packet> p = Create<Packet>(0); // 8+4 : the size of the seqTs header
-        p->AddHeader(seqTS);
-        Ptr<Packet> __p = Create<Packet>((const uint8_t *)content.c_str(), content.size());
-        p->AddAtEnd(__p);
-        NS_LOG_INFO("> Sent " << socket->SendTo(p, 0, dest));
+    // TD hops to the origin; stored ads already have us appended to their path
+    static size_t
+    PathRank(const NameDBEntry& entry, const Ipv4Address& me)
+    {
+        size_t hops = entry.td_path.size();
+        if (hops > 0 && entry.td_path[hops - 1] == me) {
+            hops--;
+        }
+        return hops;
+    }
+
+    bool
+    RIBAdStore::RankedBefore(const NameDBEntry& a, const NameDBEntry& b) const
+    {
+        RIB *rib = (RIB *)(this->parent_ctx);
+        Ipv4Address me = Ipv4Address::ConvertFrom(rib->my_addr);
+        size_t hopsA = PathRank(a, me);
+        size_t hopsB = PathRank(b, me);
+        if (m_rankBy == RANK_LATENCY && a.latency != b.latency) {
+            return a.latency < b.latency;
+        }
+        if (hopsA != hopsB) {
+            return hopsA < hopsB;
+        }
+        if (a.latency != b.latency) {
+            return a.latency < b.latency;
+        }
+        return a.origin_AS_addr.Get() < b.origin_AS_addr.Get();
     }
 
+    /* The origins of a name are kept ranked in db, so replies never sort */
     void
-    RIBAdStore::HandleRead(Ptr<Socket> socket)
+    RIBAdStore::InsertRanked(std::vector<NameDBEntryPtr>& all_ads, NameDBEntryPtr entry)
     {
-        NS_LOG_FUNCTION(this << socket);
-        Ptr<Packet> packet;
-        Address from;
-        Address localAddress;
-        while ((packet = socket->RecvFrom(from)))
-        {
-            socket->GetSockName(localAddress);
-            m_rxTrace(packet);
-            m_rxTraceWithAddresses(packet, from, localAddress);
-            if (packet->GetSize() > 0)
-            {
-                // uint32_t receivedSize = packet->GetSize();
-                // SeqTsHeader seqTs;
-                // packet->RemoveHeader(seqTs);
+        auto pos = all_ads.begin();
+        while (pos != all_ads.end() && !RankedBefore(*entry, **pos)) {
+            ++pos;
+        }
+        all_ads.insert(pos, std::move(entry));
+    }
 
-                std::stringstream ss;
-                packet->CopyData(&ss, packet->GetSize());
-                std::string ad(ss.str());
+    /* Latency to the origin AS of an ad that just arrived: the measured delay
+     * from the peer that sent it, plus the mean measured peer delay for every
+     * TD hop behind that peer. */
+    Time
+    RIBAdStore::EstimateLatency(const NameDBEntry& entry)
+    {
+        if (entry.td_path.empty() || m_peerDelay.empty()) {
+            return Seconds(0);
+        }
+        Time total = Seconds(0);
+        for (auto& [peer, delay] : m_peerDelay) {
+            total += delay;
+        }
+        Time mean = total / (int64_t)m_peerDelay.size();
 
-                
-                if (ad == "GIVESWITCHES"){
-                    SendOverlaySwitches(socket, from);
-                    continue;
-                }
+        auto sender = m_peerDelay.find(entry.td_path[entry.td_path.size() - 1].Get());
+        Time first = sender != m_peerDelay.end() ? sender->second : mean;
+        return first + mean * (int64_t)(entry.td_path.size() - 1);
+    }
 
-                if (ad.substr(0, 7) == "GIVEADS") {
-                    SendClients(socket, from, ad.substr(8)); // Packet Format is "GIVEADS [dc name]", thus start from index 8
-                    continue;
-                }
+    /* Drops the stored ad withdrawn by withdrawal and remembers the withdrawal so
+     * copies of the old ad still in flight are not taken back in. Return false
+     * if the withdrawal is not news (already applied, or the ad is newer). */
+    bool
+    RIBAdStore::RemoveFromNameCache(const NameDBEntry& withdrawal)
+    {
+        RIB *rib = (RIB *)(this->parent_ctx);
+        const std::string& dc_name = rib->names.Intern(withdrawal.dc_name);
+        auto key = std::make_pair(dc_name, withdrawal.origin_AS_addr.Get());
 
-                // * Remove header
-                uint32_t receivedSize = packet->GetSize();
-                SeqTsHeader seqTs;
-                packet->RemoveHeader(seqTs);
+        auto withdrawn = m_withdrawn.find(key);
+        if (withdrawn != m_withdrawn.end() && withdrawal.seq <= withdrawn->second) {
+            return false;
+        }
 
-                ss.str("");
-                ss.clear(); // clear state flags
-                packet->CopyData(&ss, packet->GetSize());
-                ad = ss.str();
-                // * printout the received packet body
-                RIB *rib = (RIB *)(this->parent_ctx);
-                // NS_LOG_INFO("I am ribadstore at " << Ipv4Address::ConvertFrom(rib->my_addr));
-                NS_LOG_INFO("" << Ipv4Address::ConvertFrom(rib->my_addr) <<  " received: " << ad);
+        auto it = db.find(dc_name);
+        if (it != db.end()) {
+            std::vector<NameDBEntryPtr>& all_ads = it->second;
+            for (auto ad = all_ads.begin(); ad != all_ads.end(); ++ad) {
+                if ((*ad)->origin_AS_addr == withdrawal.origin_AS_addr) {
+                    if ((*ad)->seq > withdrawal.seq) {
+                        return false;
+                    }
+                    ReleaseAdEdges(ad->get());
+                    UnindexAd(ad->get());
+                    all_ads.erase(ad);
+                    m_rankedAds.erase(dc_name);
+                    break;
+                }
+            }
+            // the trie key goes on its next lookup
+            if (all_ads.empty()) {
+                db.erase(it);
+            }
+            ShareWithShard(dc_name);
+        }
+        m_withdrawn[key] = withdrawal.seq;
+        return true;
+    }
 
-                // * deserialize the advertisement packet
-                NameDBEntry* advertised_entry = NameDBEntry::FromAdvertisementStr(ad);
+    /* Withdrawals travel the same flooding path as ads. At the origin AS the
+     * withdrawal gets the next sequence number of the name, elsewhere it must
+     * come from a peer. Return true if it changed the db and was forwarded. */
+    bool
+    RIBAdStore::ApplyWithdrawal(Ptr<Socket> socket, NameDBEntryPtr withdrawal, Address from)
+    {
+        RIB *rib = (RIB *)(this->parent_ctx);
+        Ipv4Address my_addr = Ipv4Address::ConvertFrom(rib->my_addr);
 
-                if (advertised_entry == nullptr) {
-                    NS_LOG_ERROR("Cannot parse ads: " << ad);
-                    // std::abort();
-                    continue;
-                }
+        if (withdrawal->origin_AS_addr == my_addr) {
+            if (!withdrawal->td_path.empty()) {
+                return false;
+            }
+            withdrawal->seq = ++m_originSeq[withdrawal->dc_name];
+            if (m_summaryMode) {
+                RemoveFromSummary(withdrawal->dc_name);
+            }
+        } else {
+            if (withdrawal->td_path.empty() || !rib->peers.Find(withdrawal->td_path[withdrawal->td_path.size() - 1])) {
+                NS_LOG_INFO("Withdrawal not forwarded by a peer. Dropping...");
+                return false;
+            }
+        }
 
-                // check if self is already in advertisement path to avoid loop
-                bool is_loop = false;
-                Ipv4Address my_addr = Ipv4Address::ConvertFrom(rib->my_addr);
-                for (auto addr : advertised_entry->td_path) {
-                    if (addr == my_addr) {
-                        is_loop = true;
-                        break;
-                    }
-                }
-                if (is_loop) {
-                    NS_LOG_INFO("Detected advertising loop, ignoring current ads...");
-                    continue;
-                }
+        if (!RemoveFromNameCache(*withdrawal)) {
+            return false;
+        }
+        NS_LOG_INFO("Withdrew " << rib->names.GetLabel(withdrawal->dc_name) << " from origin " << withdrawal->origin_AS_addr
+                    << " up to seq " << withdrawal->seq);
 
-                bool updated = UpdateNameCache(advertised_entry);
-
-                NS_LOG_INFO("Number of ads: " << db.size());
-
-                NS_LOG_INFO("7123870127491273901275649604917284912074891274912749812");
-
-                if (updated) {
-                    // add itself to the td_path of the advertisement
-                    advertised_entry->td_path.push_back(my_addr);
-                    std::string serialized = advertised_entry->ToAdvertisementStr();
-
-                    // (trust related) if current AS is the origin AS, don't forward if no certificate about 
-                    // the origin server from the data capsule owner
-                    auto& trust_relation_map = rib->certStore->trustRelations;
-
-                    bool trust_curr_AS = false;
-                    bool is_origin_AS_for_curr_ad = advertised_entry->origin_AS_addr == my_addr;
-                    
-                    // If I am not the origin AS and the ad is forwarded from someone not in my peer,
-                    // Drop it
-                    
-                    if (!is_origin_AS_for_curr_ad){
-                        if (advertised_entry->td_path.size() <= 1) continue;
-                        bool found = false;
-                        Address sender_addr = advertised_entry->td_path[advertised_entry->td_path.size() - 2];
-                        for (auto &x: rib->peers){
-                            // Costly search. TODO: Define a reverse map to make it constant / log n time
-                            if (x.second == sender_addr){
-                                found = true;
-                                break;
-                            }
-                        }
-                        if (!found){
-                            NS_LOG_INFO("Potentially malicious advertisement. No changes made to trust relations. Dropping...");
-                            continue;
-                        }
-                    }
+        if (!withdrawal->td_path.push_back(my_addr)) {
+            return true;
+        }
+        // Withdrawals are always flooded: pull rounds only repair missing ads, not removals
+        Ptr<Packet> serialized = SerializeAd(withdrawal.get());
+        for (auto& peer : rib->peers) {
+            Address dest_socket = InetSocketAddress(Ipv4Address::ConvertFrom(peer.addr), RIBADSTORE_PORT);
+            if (dest_socket != from && peer.addr != withdrawal->origin_AS_addr) {
+                EnqueueAd(socket, withdrawal.get(), serialized, dest_socket);
+            }
+        }
+        return true;
+    }
 
+    /* An owner distrusting the server of an ad we originated withdraws that ad */
+    void
+    RIBAdStore::NotifyDistrust(const std::string& issuer, const std::string& entity)
+    {
+        RIB *rib = (RIB *)(this->parent_ctx);
+        auto it = db.find(RIBCertStore::CertName(issuer));
+        if (it == db.end()) {
+            return;
+        }
 
-                    // for (auto it = trust_relation_map.begin(); it != trust_relation_map.end(); it ++) {
-                    //     NS_LOG_INFO("issuer: " << it->first << ", entity: " << it->second.first << ", type: " << it->second.second);
-                    // }
-                    if (is_origin_AS_for_curr_ad) {
-                        // WARNING: VERY VERY HACKY!!!!!
-                        std::string __chk_name = "fogrobotics1";
-                        auto [range_begin, range_end] = trust_relation_map.equal_range("fogrobotics1:" + advertised_entry->dc_name);
-                        if (range_begin == range_end){
-                            auto [__range_begin, __range_end] = trust_relation_map.equal_range("fogrobotics2:" + advertised_entry->dc_name);
-                            range_begin = __range_begin;
-                            range_end = __range_end;
-                            __chk_name = "fogrobotics2";
-                        }
-                        if (range_begin == range_end){
-                            auto [__range_begin, __range_end] = trust_relation_map.equal_range("fogrobotics3:" + advertised_entry->dc_name);
-                            range_begin = __range_begin;
-                            range_end = __range_end;
-                            __chk_name = "fogrobotics3";
-                        }
-                        for (auto it = range_begin; it != range_end; it++) {
-                            // check if "entity" is the data capsule server name
-                            if (Ipv4Address((it->second.first).c_str()) == advertised_entry->origin_server) {
-                                trust_curr_AS = true;
-                                // * Attach trust from DC owner to current name to the advertisement
-                                advertised_entry->trust_cert.issuer = it->first;
-                                advertised_entry->trust_cert.entity = it->second.first;
-                                advertised_entry->trust_cert.r_transitivity = it->second.second;
-                                advertised_entry->trust_cert.type = "trust";
-                                // * Attach distrust relations of the DC owner
-                                auto& distrust_relation_map = rib->certStore->distrustRelations;
-                                auto [range_start, range_stop] = distrust_relation_map.equal_range(__chk_name + ":" + advertised_entry->dc_name);
-                                for (auto it = range_start; it != range_stop; ++it) {
-                                    advertised_entry->distrust_certs.push_back(
-                                        NameDBEntry::DistrustCert {"distrust", it->second, it->first}
-                                    );
-                                }
-                                serialized = advertised_entry->ToAdvertisementStr();
-                                break;
-                            }
-                        }
-                    }
-                    // if is_origin_AS_for_curr_ad, only forward if trust relation exist between DC owner and the DC server in my domain
-                    // otherwise, flooding as usual
-                    if (trust_curr_AS&&is_origin_AS_for_curr_ad) {
-                        NS_LOG_INFO("I am origin AS, trust relationship exist, so forwarding ads to my peer.....");
-                    }
-                    if (!trust_curr_AS&&is_origin_AS_for_curr_ad) {
-                        NS_LOG_INFO("I am origin AS, trust relationship does not exist, thus dropping this advertisement from the DC server advertiser.....");
-                    }
-                    
-                    // save the received trust and distrust relations in local ribcertstore cache
-                    if (!is_origin_AS_for_curr_ad) {
-                        // * if not empty trust relation, add to cache
-                        if ( !(advertised_entry->trust_cert.issuer.size() == 0
-                            && advertised_entry->trust_cert.entity.size() == 0
-                            && advertised_entry->trust_cert.r_transitivity == 0) ) {
-                                std::pair<std::string, int> __val = std::make_pair(advertised_entry->trust_cert.entity, advertised_entry->trust_cert.r_transitivity);
-                                rib->trustRelations->insert(std::make_pair(advertised_entry->trust_cert.issuer, __val));
-                                std::pair<std::string, int> __val2 = std::make_pair(advertised_entry->trust_cert.issuer, INT_MAX);
-                                rib->trustRelations->insert(std::make_pair(advertised_entry->trust_cert.entity, __val2));
-                        }
+        Ipv4Address my_addr = Ipv4Address::ConvertFrom(rib->my_addr);
+        for (auto& ad : it->second) {
+            if (ad->origin_AS_addr == my_addr && ad->trust_cert.issuer == issuer && ad->trust_cert.entity == entity) {
+                std::string dc_name = ad->dc_name;
+                Ipv4Address origin_server = ad->origin_server;
+                NameDBEntryPtr withdrawal = entryPool.Create(dc_name, my_addr, TdPath(), origin_server,
+                                                             NameDBEntry::TrustCert{"", "", "", 0},
+                                                             std::vector<NameDBEntry::DistrustCert>());
+                withdrawal->withdrawn = true;
+                // invalidates ad, it is erased from db
+                ApplyWithdrawal(m_socket, std::move(withdrawal), Address());
+                return;
+            }
+        }
+    }
 
-                        if (advertised_entry->distrust_certs.size() != 0) {
-                            for (auto& item : advertised_entry->distrust_certs) {
-                                rib->distrustRelations->insert(std::make_pair(item.issuer, item.entity));
-                            }
-                        }
+    // Trust edges an ad adds to the graph: along td_path towards the origin, and origin AS -> DC server
+    std::vector<std::pair<std::string, std::string>>
+    RIBAdStore::AdEdges(const NameDBEntry* entry)
+    {
+        std::vector<std::pair<std::string, std::string>> edges;
+        RIB *rib = (RIB *)(this->parent_ctx);
 
-                        // Include the td_path in trust relations, Otherwise the graph is not complete
-                        for (size_t i = 0; i < advertised_entry->td_path.size() - 1; i++){
-                            Address u = advertised_entry->td_path[i + 1];
-                            Address v = advertised_entry->td_path[i];
-                            std::stringstream asu, asv;
-
-                            auto itu = rib->rib_addr_map_.find(u);
-                            if (itu == rib->rib_addr_map_.end()){
-                                continue;
-                            }
-                            asu << "AS" << itu->second;
-
-                            auto itv = rib->rib_addr_map_.find(v);
-                            if (itv == rib->rib_addr_map_.end()){
-                                continue;
-                            }
-                            asv << "AS" << itv->second;
-                            rib->trustRelations->insert({asu.str(), {asv.str(), INT_MAX}});
-                            NS_LOG_INFO("From RIB: AS" << rib->rib_addr_map_[rib->my_addr] << " Inserted extra: " << asu.str() << " -> " << asv.str());
-                        }
+        for (size_t i = 0; i + 1 < entry->td_path.size(); i++){
+            auto itu = rib->rib_addr_map_.find(entry->td_path[i + 1]);
+            auto itv = rib->rib_addr_map_.find(entry->td_path[i]);
+            if (itu == rib->rib_addr_map_.end() || itv == rib->rib_addr_map_.end()){
+                continue;
+            }
+            edges.push_back(std::make_pair("AS" + std::to_string(itu->second), "AS" + std::to_string(itv->second)));
+        }
 
-                        // Include DCServer -> TD map
-                        std::stringstream originStr, dcServerStr;
-                        originStr << "AS" << rib->rib_addr_map_[advertised_entry->origin_AS_addr];
-                        dcServerStr << advertised_entry->origin_server;
-                        rib->trustRelations->insert({originStr.str(), {dcServerStr.str(), INT_MAX}});
-                    }
+        auto origin = rib->rib_addr_map_.find(entry->origin_AS_addr);
+        if (origin != rib->rib_addr_map_.end()){
+            std::stringstream dcServerStr;
+            dcServerStr << entry->origin_server;
+            edges.push_back(std::make_pair("AS" + std::to_string(origin->second), dcServerStr.str()));
+        }
+        return edges;
+    }
 
-                    if ((trust_curr_AS&&is_origin_AS_for_curr_ad) || !is_origin_AS_for_curr_ad) {
-                        for (auto& [AS_num, addr] : rib->peers) {
-                            //   cases not to forward:
-                            //     1. the destination is what this ads came from
-                            //     2. the destination is the origin AS
-                            //     3. ...
-                            Address dest_socket = InetSocketAddress(Ipv4Address::ConvertFrom(addr), RIBADSTORE_PORT);   
-                            if (dest_socket != from && addr != advertised_entry->origin_AS_addr) {
-                                
-                                Ipv4Address temp = Ipv4Address::ConvertFrom(addr);
-                                std::stringstream ss;
-                                my_addr.Print(ss);
-                                NS_LOG_INFO("RIB:" << ss.str() << ". Forward Ads to " << temp);
-                                // introduce arbitrary delay to do the advertisement
-                                // source: https://stackoverflow.com/questions/288739/generate-random-numbers-uniformly-over-an-entire-range
-                                std::random_device rand_dev;
-                                std::mt19937 generator(rand_dev());
-                                std::uniform_int_distribution<int> distr(0, 10);
-
-                                Simulator::Schedule(Seconds(distr(generator)), &RIBAdStore::ForwardAds, this, socket, serialized, dest_socket);
-                                // Simulator::ScheduleNow(&RIBAdStore::ForwardAds, this, socket, serialized, dest_socket);
-                            }
-                        }
-                    }
-                    
-                } else {
-                    delete advertised_entry;
-                }
+    void
+    RIBAdStore::RetainAdEdges(NameDBEntry* entry)
+    {
+        RIB *rib = (RIB *)(this->parent_ctx);
+        if (entry->edges_retained) {
+            return;
+        }
+        for (auto& [u, v] : AdEdges(entry)) {
+            rib->certStore->RetainAdEdge(u, v);
+            NS_LOG_INFO("From RIB: AS" << rib->rib_addr_map_[rib->my_addr] << " Inserted extra: " << u << " -> " << v);
+        }
+        entry->edges_retained = true;
+    }
 
-                NS_LOG_INFO("ajsdfoijaofweifn,dasnf,masdnfm,asnfd,mnasd,fnwefiowe");
+    void
+    RIBAdStore::ReleaseAdEdges(NameDBEntry* entry)
+    {
+        RIB *rib = (RIB *)(this->parent_ctx);
+        if (!entry->edges_retained) {
+            return;
+        }
+        for (auto& [u, v] : AdEdges(entry)) {
+            rib->certStore->ReleaseAdEdge(u, v);
+        }
+        entry->edges_retained = false;
+    }
 
-                
+    void
+    RIBAdStore::AddToSummary(const std::string& dc_name)
+    {
+        if (!m_summaryNames.insert(dc_name).second) {
+            return;
+        }
+        for (uint32_t index : m_localSummary.Add(dc_name)) {
+            m_summaryDelta[index] = true;
+        }
+        if (!m_summaryEvent.IsRunning()) {
+            m_summaryEvent = Simulator::Schedule(m_batchFlushInterval, &RIBAdStore::FlushSummary, this);
+        }
+    }
 
-                
-                uint32_t currentSequenceNumber = seqTs.GetSeq();
-                if (InetSocketAddress::IsMatchingType(from))
-                {
-                    NS_LOG_INFO("TraceDelay: RX " << receivedSize << " bytes from "
-                                                << InetSocketAddress::ConvertFrom(from).GetIpv4()
-                                                << " Sequence Number: " << currentSequenceNumber
-                                                << " Uid: " << packet->GetUid() << " TXtime: "
-                                                << seqTs.GetTs() << " RXtime: " << Simulator::Now()
-                                                << " Delay: " << Simulator::Now() - seqTs.GetTs());
-                }
-                else if (Inet6SocketAddress::IsMatchingType(from))
-                {
-                    NS_LOG_INFO("TraceDelay: RX " << receivedSize << " bytes from "
-                                                << Inet6SocketAddress::ConvertFrom(from).GetIpv6()
-                                                << " Sequence Number: " << currentSequenceNumber
-                                                << " Uid: " << packet->GetUid() << " TXtime: "
-                                                << seqTs.GetTs() << " RXtime: " << Simulator::Now()
-                                                << " Delay: " << Simulator::Now() - seqTs.GetTs());
-                }
+    void
+    RIBAdStore::RemoveFromSummary(const std::string& dc_name)
+    {
+        if (m_summaryNames.erase(dc_name) == 0) {
+            return;
+        }
+        for (uint32_t index : m_localSummary.Remove(dc_name)) {
+            m_summaryDelta[index] = false;
+        }
+        if (!m_summaryEvent.IsRunning()) {
+            m_summaryEvent = Simulator::Schedule(m_batchFlushInterval, &RIBAdStore::FlushSummary, this);
+        }
+    }
 
-                m_lossCounter.NotifyReceived(currentSequenceNumber);
-                m_received++;
+    /* Summary protocol (plain text, no SeqTs header), flooded like ads:
+     *   "SUMFULL <origin> <version> <bits> <hashes> <hex bitmap>"
+     *   "SUMDELTA <origin> <version> <bit>:<0|1> ..."    bits changed since version - 1
+     *   "SUMREQ <origin>"                                 a delta was missed, send SUMFULL
+     * The first version and deltas larger than the bitmap go out as SUMFULL. */
+    void
+    RIBAdStore::FlushSummary()
+    {
+        if (m_summaryDelta.empty()) {
+            return;
+        }
+        RIB *rib = (RIB *)(this->parent_ctx);
+        Ipv4Address my_addr = Ipv4Address::ConvertFrom(rib->my_addr);
+
+        m_summaryVersion++;
+        std::stringstream ss;
+        if (m_summaryVersion == 1 || m_summaryDelta.size() * 8 > m_localSummary.GetBits() / 4) {
+            ss << "SUMFULL " << my_addr << " " << m_summaryVersion << " " << m_localSummary.GetBits() << " "
+               << m_localSummary.GetHashes() << " " << m_localSummary.ToHex();
+        } else {
+            ss << "SUMDELTA " << my_addr << " " << m_summaryVersion;
+            for (auto& [index, set] : m_summaryDelta) {
+                ss << " " << index << ":" << (set ? 1 : 0);
             }
         }
+        m_summaryDelta.clear();
+
+        std::string msg = ss.str();
+        NS_LOG_INFO("Sending summary version " << m_summaryVersion << " (" << msg.size() << " bytes) with " << m_summaryNames.size() << " names");
+        for (auto& peer : rib->peers) {
+            Ptr<Packet> p = Create<Packet>((const uint8_t *)msg.c_str(), msg.size());
+            m_socket->SendTo(p, 0, InetSocketAddress(Ipv4Address::ConvertFrom(peer.addr), RIBADSTORE_PORT));
+        }
+    }
+
+    void
+    RIBAdStore::HandleSummary(Ptr<Socket> socket, Address from, std::string& msg)
+    {
+        RIB *rib = (RIB *)(this->parent_ctx);
+        Ipv4Address my_addr = Ipv4Address::ConvertFrom(rib->my_addr);
+
+        std::stringstream ss(msg);
+        std::string type, origin_str;
+        uint32_t version = 0;
+        ss >> type >> origin_str;
+        Ipv4Address origin(origin_str.c_str());
+        if (origin == my_addr) {
+            return;
+        }
+        auto it = m_summaries.find(origin.Get());
+
+        if (type == "SUMREQ") {
+            if (it != m_summaries.end()) {
+                std::stringstream reply;
+                reply << "SUMFULL " << origin << " " << it->second.version << " " << it->second.filter.GetBits() << " "
+                      << it->second.filter.GetHashes() << " " << it->second.filter.ToHex();
+                std::string str_repr = reply.str();
+                socket->SendTo(Create<Packet>((const uint8_t *)str_repr.c_str(), str_repr.size()), 0, from);
+            }
+            return;
+        }
+
+        if (!(ss >> version)) {
+            return;
+        }
+        if (type == "SUMFULL") {
+            if (it != m_summaries.end() && version <= it->second.version) {
+                return;
+            }
+            uint32_t bits, hashes;
+            std::string hex;
+            CountingBloomFilter filter;
+            if (!(ss >> bits >> hashes >> hex) || !filter.FromHex(bits, hashes, hex)) {
+                NS_LOG_WARN("Malformed summary from " << origin);
+                return;
+            }
+            it = m_summaries.insert_or_assign(origin.Get(), RemoteSummary{version, filter, from}).first;
+        } else if (type == "SUMDELTA") {
+            if (it == m_summaries.end() || version > it->second.version + 1) {
+                // * Missed a version, ask the sender for its full copy
+                std::string str_repr = "SUMREQ " + origin_str;
+                socket->SendTo(Create<Packet>((const uint8_t *)str_repr.c_str(), str_repr.size()), 0, from);
+                return;
+            }
+            if (version <= it->second.version) {
+                return;
+            }
+            std::string change;
+            while (ss >> change) {
+                size_t sep = change.find(":");
+                if (sep == std::string::npos) {
+                    continue;
+                }
+                it->second.filter.SetBit(std::atoi(change.substr(0, sep).c_str()), change.substr(sep + 1) == "1");
+            }
+            it->second.version = version;
+            it->second.nextHop = from;
+        } else {
+            return;
+        }
+
+        // flood the accepted version on, same rules as ads
+        for (auto& peer : rib->peers) {
+            Address dest_socket = InetSocketAddress(Ipv4Address::ConvertFrom(peer.addr), RIBADSTORE_PORT);
+            if (dest_socket != from && peer.addr != origin) {
+                socket->SendTo(Create<Packet>((const uint8_t *)msg.c_str(), msg.size()), 0, dest_socket);
+            }
+        }
+    }
+
+    /* Asks every origin whose summary may hold name for its ad ("ADREQ <name> <origin>"),
+     * via the peer its summary came from. Return false if no origin may have it. */
+    bool
+    RIBAdStore::ResolveName(const std::string& name)
+    {
+        // "owner:ID" queries resolve the bare ID, or the owner's aggregate
+        size_t colon = name.rfind(":");
+        std::vector<std::string> candidates;
+        candidates.push_back(name.substr(colon == std::string::npos ? 0 : colon + 1));
+        if (colon != std::string::npos) {
+            candidates.push_back(name.substr(0, colon) + ":*");
+        }
+        if (candidates[0].empty() || candidates[0].back() == '*') {
+            return false;
+        }
+
+        bool sent = false;
+        for (auto& [origin, summary] : m_summaries) {
+            for (auto& dc_name : candidates) {
+                if (!summary.filter.MayContain(dc_name)) {
+                    continue;
+                }
+                std::stringstream ss;
+                ss << "ADREQ " << dc_name << " " << Ipv4Address(origin);
+                std::string str_repr = ss.str();
+                m_socket->SendTo(Create<Packet>((const uint8_t *)str_repr.c_str(), str_repr.size()), 0, summary.nextHop);
+                sent = true;
+            }
+        }
+        return sent;
+    }
+
+    /* A peer fetching an ad: answer from db if we have it, otherwise pass the
+     * request on towards the origin and remember who to hand the ad back to. */
+    void
+    RIBAdStore::HandleResolve(Ptr<Socket> socket, Address from, std::string& msg)
+    {
+        RIB *rib = (RIB *)(this->parent_ctx);
+        std::stringstream ss(msg);
+        std::string type, dc_name, origin_str;
+        if (!(ss >> type >> dc_name >> origin_str)) {
+            return;
+        }
+        Ipv4Address origin(origin_str.c_str());
+
+        auto it = db.find(dc_name);
+        if (it != db.end()) {
+            for (auto& entry : it->second) {
+                if (entry->origin_AS_addr == origin) {
+                    ForwardAds(socket, SerializeAd(entry.get()), from);
+                    return;
+                }
+            }
+        }
+        if (origin == Ipv4Address::ConvertFrom(rib->my_addr)) {
+            return;
+        }
+
+        auto summary = m_summaries.find(origin.Get());
+        if (summary == m_summaries.end()) {
+            return;
+        }
+        auto key = std::make_pair(dc_name, origin.Get());
+        std::set<Address>& waiting = m_pendingResolves[key];
+        bool first = waiting.empty();
+        waiting.insert(from);
+        if (first) {
+            socket->SendTo(Create<Packet>((const uint8_t *)msg.c_str(), msg.size()), 0, summary->second.nextHop);
+            Simulator::Schedule(m_resolveTimeout, [this, key]() { m_pendingResolves.erase(key); });
+        }
+    }
+
+    // A fetched ad is handed back to the peers that asked for it and answers waiting clients
+    void
+    RIBAdStore::ForwardResolved(Ptr<Socket> socket, NameDBEntry* entry, Ptr<Packet> serialized)
+    {
+        auto pending = m_pendingResolves.find(std::make_pair(entry->dc_name, entry->origin_AS_addr.Get()));
+        if (pending != m_pendingResolves.end()) {
+            for (auto& dest : pending->second) {
+                ForwardAds(socket, serialized, dest);
+            }
+            m_pendingResolves.erase(pending);
+        }
+
+        // an aggregate answers every query under its prefix
+        const std::string& name = entry->dc_name;
+        bool aggregate = name.size() >= 2 && name.compare(name.size() - 2, 2, ":*") == 0;
+        std::string prefix = "GIVEADS " + name.substr(0, name.size() - 1);
+        std::vector<std::string> answered;
+        for (auto& [key, event] : m_resolving) {
+            if (aggregate ? key.compare(0, prefix.size(), prefix) == 0
+                          : key.size() >= name.size() && key.compare(key.size() - name.size(), name.size(), name) == 0) {
+                answered.push_back(key);
+            }
+        }
+        for (auto& key : answered) {
+            AnswerQuery(key);
+        }
+    }
+
+    const RIBAdStore::DisseminationStats&
+    RIBAdStore::GetDisseminationStats() const
+    {
+        return m_stats;
+    }
+
+    /* An ad as snapshots and shard pushes carry it: its binary header, whether it
+     * holds trust edges, the measured latency and the time it has left to live. */
+    static void
+    WriteEntry(SnapshotWriter& out, NameDBEntry& entry)
+    {
+        Time now = Simulator::Now();
+        Ptr<Packet> p = Create<Packet>(0);
+        p->AddHeader(entry.ToAdvertisementHeader());
+        std::vector<uint8_t> bytes(p->GetSize());
+        p->CopyData(bytes.data(), bytes.size());
+        out.Bytes(bytes.data(), bytes.size());
+        out.U8(entry.edges_retained ? 1 : 0);
+        out.U64(entry.latency.GetNanoSeconds());
+        out.U64(entry.ttl != 0 && entry.expires > now ? (entry.expires - now).GetNanoSeconds() : 0);
+    }
+
+    static NameDBEntryPtr
+    ReadEntry(SnapshotReader& in, NameDBEntryPool& pool, bool& edges_retained)
+    {
+        uint32_t len;
+        const uint8_t* bytes = in.Bytes(len);
+        edges_retained = in.U8() != 0;
+        Time latency = NanoSeconds(in.U64());
+        Time remaining = NanoSeconds(in.U64());
+        if (!bytes || !in.Ok()) {
+            return NameDBEntryPtr();
+        }
+
+        Ptr<Packet> p = Create<Packet>(bytes, len);
+        AdvertisementHeader header;
+        p->RemoveHeader(header);
+        NameDBEntryPtr entry = NameDBEntry::FromAdvertisementHeader(header, pool);
+        if (entry) {
+            entry->latency = latency;
+            entry->expires = Simulator::Now() + remaining;
+        }
+        return entry;
+    }
+
+    /* Snapshot: sequence numbers and withdrawals, then every stored ad in its
+     * binary encoding, in ranked order, followed by what the encoding lacks. */
+    void
+    RIBAdStore::SaveState(SnapshotWriter& out)
+    {
+        out.U32(m_originSeq.size());
+        for (auto& [name, seq] : m_originSeq) {
+            out.Str(name);
+            out.U32(seq);
+        }
+
+        out.U32(m_withdrawn.size());
+        for (auto& [key, seq] : m_withdrawn) {
+            out.Str(key.first);
+            out.U32(key.second);
+            out.U32(seq);
+        }
+
+        uint32_t count = 0;
+        for (auto& pair : db) {
+            count += pair.second.size();
+        }
+        out.U32(count);
+        for (auto& pair : db) {
+            for (auto& entry : pair.second) {
+                WriteEntry(out, *entry);
+            }
+        }
+    }
+
+    // Called before the application starts, StartApplication files the expiring ads
+    bool
+    RIBAdStore::LoadState(SnapshotReader& in)
+    {
+        RIB *rib = (RIB *)(this->parent_ctx);
+
+        uint32_t count = in.U32();
+        for (uint32_t i = 0; i < count && in.Ok(); i++) {
+            std::string name = in.Str();
+            m_originSeq[rib->names.Intern(name)] = in.U32();
+        }
+
+        count = in.U32();
+        for (uint32_t i = 0; i < count && in.Ok(); i++) {
+            std::string name = in.Str();
+            uint32_t origin = in.U32();
+            m_withdrawn[std::make_pair(rib->names.Intern(name), origin)] = in.U32();
+        }
+
+        count = in.U32();
+        for (uint32_t i = 0; i < count && in.Ok(); i++) {
+            bool edges_retained;
+            NameDBEntryPtr entry = ReadEntry(in, entryPool, edges_retained);
+            if (!entry) {
+                return false;
+            }
+
+            NameDBEntry* restored = entry.get();
+            db[rib->names.Intern(restored->dc_name)].push_back(std::move(entry));
+            m_nameIndex.Insert(QualifiedName(*restored));
+            IndexAd(restored);
+            if (edges_retained) {
+                RetainAdEdges(restored);
+            }
+        }
+        return in.Ok();
+    }
+
+    // Gossip keeps a random GossipFanout of the peers an ad would be flooded to
+    void
+    RIBAdStore::SelectGossipPeers(std::vector<Address>& dests)
+    {
+        if (m_dissemination != DISSEMINATE_GOSSIP || dests.size() <= m_gossipFanout) {
+            return;
+        }
+        // partial Fisher-Yates
+        for (uint32_t i = 0; i < m_gossipFanout; i++) {
+            uint32_t j = m_rng->GetInteger(i, dests.size() - 1);
+            std::swap(dests[i], dests[j]);
+        }
+        dests.resize(m_gossipFanout);
+    }
+
+    // Identity of a stored ad for pull rounds: a newer seq is a different ad, a different path is not
+    uint64_t
+    RIBAdStore::EntryDigest(const NameDBEntry& entry)
+    {
+        std::stringstream ss;
+        ss << entry.dc_name << "|" << entry.origin_AS_addr << "|" << entry.seq;
+        return Hash64(ss.str());
+    }
+
+    /* Pull round (plain text, no SeqTs header):
+     *   "GOSSIPPULL <lo> <hi> <digest> <digest> ..."
+     * lists the digests of all our ads in the hash range [lo, hi] (hex). The peer
+     * sends back its ads in that range we did not list. Digests are split into
+     * ranges so each message fits in BatchMtu. */
+    void
+    RIBAdStore::PullRound()
+    {
+        m_pullEvent = Simulator::Schedule(m_gossipInterval, &RIBAdStore::PullRound, this);
+
+        RIB *rib = (RIB *)(this->parent_ctx);
+        if (rib->peers.empty()) {
+            return;
+        }
+        RIBPeerTable::Peer& peer = rib->peers[m_rng->GetInteger(0, rib->peers.size() - 1)];
+        Address dest = InetSocketAddress(Ipv4Address::ConvertFrom(peer.addr), RIBADSTORE_PORT);
+
+        std::vector<uint64_t> digests;
+        for (auto& pair : db) {
+            for (auto& entry : pair.second) {
+                digests.push_back(EntryDigest(*entry));
+            }
+        }
+        std::sort(digests.begin(), digests.end());
+
+        // "GOSSIPPULL " + two bounds, then 17 bytes per digest
+        uint32_t mtu = m_batchMtu == 0 ? 1400 : m_batchMtu;
+        size_t perMessage = std::max<size_t>(1, (mtu - 11 - 34) / 17);
+        size_t start = 0;
+        do {
+            size_t stop = std::min(digests.size(), start + perMessage);
+            uint64_t lo = start == 0 ? 0 : digests[start];
+            uint64_t hi = stop == digests.size() ? UINT64_MAX : digests[stop] - 1;
+            std::stringstream ss;
+            ss << std::hex << "GOSSIPPULL " << lo << " " << hi;
+            for (size_t k = start; k < stop; k++) {
+                ss << " " << digests[k];
+            }
+            std::string str_repr = ss.str();
+            m_socket->SendTo(Create<Packet>((const uint8_t *)str_repr.c_str(), str_repr.size()), 0, dest);
+            start = stop;
+        } while (start < digests.size());
+    }
+
+    void
+    RIBAdStore::HandlePull(Ptr<Socket> socket, Address from, std::string& msg)
+    {
+        RIB *rib = (RIB *)(this->parent_ctx);
+        Ipv4Address my_addr = Ipv4Address::ConvertFrom(rib->my_addr);
+        Ipv4Address peer_addr = InetSocketAddress::ConvertFrom(from).GetIpv4();
+
+        std::stringstream ss(msg);
+        std::string type;
+        uint64_t lo, hi, digest;
+        if (!(ss >> type >> std::hex >> lo >> hi)) {
+            return;
+        }
+        std::unordered_set<uint64_t> theirs;
+        while (ss >> digest) {
+            theirs.insert(digest);
+        }
+
+        uint32_t sent = 0;
+        for (auto& pair : db) {
+            for (auto& entry : pair.second) {
+                // * only what we would have pushed: trusted own ads, and peer ads that passed the checks
+                bool forwardable = entry->origin_AS_addr == my_addr ? !entry->trust_cert.issuer.empty() : entry->edges_retained;
+                uint64_t mine = EntryDigest(*entry);
+                if (!forwardable || entry->origin_AS_addr == peer_addr || mine < lo || mine > hi || theirs.count(mine)) {
+                    continue;
+                }
+                EnqueueAd(socket, entry.get(), SerializeAd(entry.get()), from);
+                sent++;
+            }
+        }
+        if (sent > 0) {
+            NS_LOG_INFO("Pull from " << peer_addr << " is missing " << sent << " ads");
+        }
+    }
+
+    void
+    RIBAdStore::ScheduleExpiry(NameDBEntry* entry)
+    {
+        if (entry->ttl == 0) {
+            return;
+        }
+        entry->expires = Simulator::Now() + Seconds(entry->ttl);
+        m_expiry.Schedule(std::make_pair(entry->dc_name, entry->origin_AS_addr.Get()), entry->expires);
+    }
+
+    /* Ads are dropped locally when their TTL runs out; nothing is flooded, every
+     * RIB holding the ad expires it on its own clock. Refreshed ads only had
+     * their expiry time moved and go back into the wheel. */
+    void
+    RIBAdStore::ExpiryTick()
+    {
+        m_expiryEvent = Simulator::Schedule(m_expiryGranularity, &RIBAdStore::ExpiryTick, this);
+
+        RIB *rib = (RIB *)(this->parent_ctx);
+        Time now = Simulator::Now();
+        for (auto& key : m_expiry.Advance(now)) {
+            auto it = db.find(key.first);
+            if (it == db.end()) {
+                continue;
+            }
+            std::vector<NameDBEntryPtr>& all_ads = it->second;
+            for (auto ad = all_ads.begin(); ad != all_ads.end(); ++ad) {
+                if ((*ad)->origin_AS_addr.Get() != key.second || (*ad)->ttl == 0) {
+                    continue;
+                }
+                if ((*ad)->expires > now) {
+                    m_expiry.Schedule(key, (*ad)->expires);
+                    break;
+                }
+                NS_LOG_INFO("Ad of " << rib->names.GetLabel(key.first) << " from " << Ipv4Address(key.second) << " expired");
+                m_expiredTrace(key.first, Ipv4Address(key.second));
+                if (m_summaryMode && (*ad)->origin_AS_addr == rib->my_addr) {
+                    RemoveFromSummary(key.first);
+                }
+                ReleaseAdEdges(ad->get());
+                UnindexAd(ad->get());
+                ForgetSeen(ad->get());
+                all_ads.erase(ad);
+                m_rankedAds.erase(key.first);
+                ShareWithShard(key.first);
+                break;
+            }
+            if (all_ads.empty()) {
+                db.erase(it);
+            }
+        }
+    }
+
+    /* With RIB replicas, the primary keeps every ad (it runs the inter-TD protocol)
+     * and pushes the ads of a name to the shard owning it whenever they change:
+     *   "SHARDADS\n" <name> <count> <entry>...   (snapshot encoding)
+     * The push replaces what the shard held for the name; count 0 drops it. */
+    void
+    RIBAdStore::ShareWithShard(const std::string& dc_name)
+    {
+        RIB *rib = (RIB *)(this->parent_ctx);
+        if (rib->primary || rib->shards.Size() <= 1 || !m_socket) {
+            return;
+        }
+        if (rib->shards.Owner(dc_name) == rib->my_addr) {
+            return;
+        }
+        m_shardDirty.insert(dc_name);
+        if (!m_shardEvent.IsRunning()) {
+            m_shardEvent = Simulator::ScheduleNow(&RIBAdStore::FlushShards, this);
+        }
+    }
+
+    void
+    RIBAdStore::FlushShards()
+    {
+        RIB *rib = (RIB *)(this->parent_ctx);
+        for (auto& dc_name : m_shardDirty) {
+            SnapshotWriter out;
+            out.Str(dc_name);
+            auto it = db.find(dc_name);
+            out.U32(it == db.end() ? 0 : it->second.size());
+            if (it != db.end()) {
+                for (auto& entry : it->second) {
+                    WriteEntry(out, *entry);
+                }
+            }
+
+            std::string msg = "SHARDADS\n" + out.Data();
+            Address shard = InetSocketAddress(Ipv4Address::ConvertFrom(rib->shards.Owner(dc_name)), RIBADSTORE_PORT);
+            m_socket->SendTo(Create<Packet>((const uint8_t *)msg.data(), msg.size()), 0, shard);
+        }
+        m_shardDirty.clear();
+    }
+
+    void
+    RIBAdStore::HandleShardAds(std::string& msg)
+    {
+        RIB *rib = (RIB *)(this->parent_ctx);
+        SnapshotReader in((const uint8_t *)msg.data() + 9, msg.size() - 9);
+        std::string name = in.Str();
+        uint32_t count = in.U32();
+        std::vector<NameDBEntryPtr> entries;
+        std::vector<bool> retained;
+        for (uint32_t i = 0; i < count && in.Ok(); i++) {
+            bool edges_retained;
+            NameDBEntryPtr entry = ReadEntry(in, entryPool, edges_retained);
+            if (!entry) {
+                NS_LOG_INFO("Malformed SHARDADS");
+                return;
+            }
+            entries.push_back(std::move(entry));
+            retained.push_back(edges_retained);
+        }
+        if (!in.Ok()) {
+            NS_LOG_INFO("Malformed SHARDADS");
+            return;
+        }
+
+        const std::string& dc_name = rib->names.Intern(name);
+        auto it = db.find(dc_name);
+        if (it != db.end()) {
+            for (auto& ad : it->second) {
+                ReleaseAdEdges(ad.get());
+                UnindexAd(ad.get());
+            }
+            db.erase(it);
+        }
+        m_rankedAds.erase(dc_name);
+        if (entries.empty()) {
+            return;
+        }
+
+        std::vector<NameDBEntryPtr>& all_ads = db[dc_name];
+        for (size_t i = 0; i < entries.size(); i++) {
+            NameDBEntry* entry = entries[i].get();
+            all_ads.push_back(std::move(entries[i]));
+            m_nameIndex.Insert(QualifiedName(*entry));
+            IndexAd(entry);
+            if (retained[i]) {
+                RetainAdEdges(entry);
+            }
+            if (entry->ttl != 0) {
+                m_expiry.Schedule(std::make_pair(entry->dc_name, entry->origin_AS_addr.Get()), entry->expires);
+            }
+        }
+    }
+
+    /* "REFRESH <count> <digest>" from one of our DC servers: count and (hex) sum of
+     * Hash64 of the names it advertises. If that matches the ads we hold from it,
+     * they are refreshed and a refresh is flooded for them; otherwise the server is
+     * told to "RESYNC", i.e. send all of its ads again. */
+    void
+    RIBAdStore::HandleServerRefresh(Ptr<Socket> socket, Address from, std::string& msg)
+    {
+        RIB *rib = (RIB *)(this->parent_ctx);
+        std::stringstream ss(msg);
+        std::string type;
+        uint32_t count;
+        uint64_t digest;
+        if (!(ss >> type >> count >> std::hex >> digest) || !InetSocketAddress::IsMatchingType(from)) {
+            return;
+        }
+        Ipv4Address server = InetSocketAddress::ConvertFrom(from).GetIpv4();
+
+        std::vector<NameDBEntry*> served;
+        uint64_t mine = 0;
+        auto own = m_byOrigin.find(Ipv4Address::ConvertFrom(rib->my_addr).Get());
+        if (own != m_byOrigin.end()) {
+            for (auto& [digest, entry] : own->second) {
+                if (entry->origin_server == server) {
+                    served.push_back(entry);
+                    mine += Hash64(entry->dc_name);
+                }
+            }
+        }
+
+        if (served.size() != count || mine != digest) {
+            NS_LOG_INFO("Refresh from " << server << " does not match our " << served.size() << " ads, asking for a resync");
+            std::string str_repr = "RESYNC";
+            socket->SendTo(Create<Packet>((const uint8_t *)str_repr.c_str(), str_repr.size()), 0, from);
+            return;
+        }
+
+        Time now = Simulator::Now();
+        for (NameDBEntry* entry : served) {
+            entry->expires = now + Seconds(entry->ttl);
+            ShareWithShard(entry->dc_name);
+        }
+        // * Refreshes of all our servers within a flush interval go out together
+        if (!m_refreshEvent.IsRunning()) {
+            m_refreshEvent = Simulator::Schedule(m_batchFlushInterval, &RIBAdStore::FloodRefresh, this);
+        }
+    }
+
+    /* Refresh flood (plain text, no SeqTs header):
+     *   "ADREFRESH <origin> <epoch> <chunk> <digest> <digest> ..."
+     * EntryDigest (hex) of the origin's ads that are still alive. Each RIB passes
+     * an (origin, epoch, chunk) on once, through the peers' outboxes (MRAI) and to
+     * a gossip subset in gossip mode; chunks keep messages within BatchMtu. */
+    void
+    RIBAdStore::FloodRefresh()
+    {
+        RIB *rib = (RIB *)(this->parent_ctx);
+        Ipv4Address my_addr = Ipv4Address::ConvertFrom(rib->my_addr);
+
+        std::vector<uint64_t> digests;
+        auto own = m_byOrigin.find(my_addr.Get());
+        if (own != m_byOrigin.end()) {
+            for (auto& [digest, entry] : own->second) {
+                // * only ads we flooded, i.e. with the owner's trust attached
+                if (entry->ttl != 0 && !entry->trust_cert.issuer.empty()) {
+                    digests.push_back(digest);
+                }
+            }
+        }
+        if (digests.empty()) {
+            return;
+        }
+        std::vector<Address> dests;
+        for (auto& peer : rib->peers) {
+            dests.push_back(InetSocketAddress(Ipv4Address::ConvertFrom(peer.addr), RIBADSTORE_PORT));
+        }
+        m_refreshEpoch++;
+
+        uint32_t mtu = m_batchMtu == 0 ? 1400 : m_batchMtu;
+        size_t perMessage = std::max<size_t>(1, (mtu - 40) / 17);
+        for (size_t start = 0, chunk = 0; start < digests.size(); start += perMessage, chunk++) {
+            std::stringstream ss;
+            ss << "ADREFRESH " << my_addr << " " << m_refreshEpoch << " " << chunk << std::hex;
+            for (size_t k = start; k < std::min(digests.size(), start + perMessage); k++) {
+                ss << " " << digests[k];
+            }
+            std::string str_repr = ss.str();
+            // * each chunk goes to its own gossip subset
+            std::vector<Address> chunkDests = dests;
+            SelectGossipPeers(chunkDests);
+            for (auto& dest : chunkDests) {
+                EnqueueRefresh(m_socket, dest, my_addr.Get(), m_refreshEpoch, chunk, str_repr);
+            }
+        }
+        NS_LOG_INFO("Flooded refresh " << m_refreshEpoch << " for " << digests.size() << " ads");
+    }
+
+    void
+    RIBAdStore::HandleRefresh(Ptr<Socket> socket, Address from, std::string& msg)
+    {
+        RIB *rib = (RIB *)(this->parent_ctx);
+        std::stringstream ss(msg);
+        std::string type, origin_str;
+        uint32_t epoch, chunk;
+        if (!(ss >> type >> origin_str >> epoch >> chunk)) {
+            return;
+        }
+        Ipv4Address origin(origin_str.c_str());
+        if (origin == rib->my_addr) {
+            return;
+        }
+
+        RefreshSeen& seen = m_refreshSeen[origin.Get()];
+        if (epoch < seen.epoch) {
+            return;
+        }
+        if (epoch > seen.epoch) {
+            seen.epoch = epoch;
+            seen.chunks.clear();
+        }
+        if (!seen.chunks.insert(chunk).second) {
+            return;
+        }
+
+        std::unordered_set<uint64_t> digests;
+        uint64_t digest;
+        ss >> std::hex;
+        while (ss >> digest) {
+            digests.insert(digest);
+        }
+
+        Time now = Simulator::Now();
+        auto& stored = m_byOrigin[origin.Get()];
+        std::vector<uint64_t> missing;
+        for (uint64_t digest : digests) {
+            auto it = stored.find(digest);
+            if (it == stored.end()) {
+                missing.push_back(digest);
+                continue;
+            }
+            NameDBEntry* entry = it->second;
+            if (entry->ttl != 0) {
+                entry->expires = now + Seconds(entry->ttl);
+                ShareWithShard(entry->dc_name);
+            }
+        }
+
+        // * Ads we lost (a refresh missed or late, the ad expired) are asked back from the
+        // peer that passed the refresh on; flooding alone never sends them again.
+        // Summary mode fetches ads on demand instead.
+        if (!missing.empty() && !m_summaryMode) {
+            std::stringstream pull;
+            pull << "ADPULL " << origin << std::hex;
+            for (uint64_t digest : missing) {
+                pull << " " << digest;
+            }
+            std::string str_repr = pull.str();
+            socket->SendTo(Create<Packet>((const uint8_t *)str_repr.c_str(), str_repr.size()), 0, from);
+            NS_LOG_INFO("Refresh of " << origin << " names " << missing.size() << " ads we lack, pulling them");
+        }
+
+        // * Paced and fanned out like the ads it refreshes
+        std::vector<Address> dests;
+        for (auto& peer : rib->peers) {
+            Address dest_socket = InetSocketAddress(Ipv4Address::ConvertFrom(peer.addr), RIBADSTORE_PORT);
+            if (dest_socket != from && peer.addr != origin) {
+                dests.push_back(dest_socket);
+            }
+        }
+        SelectGossipPeers(dests);
+        for (auto& dest : dests) {
+            EnqueueRefresh(socket, dest, origin.Get(), epoch, chunk, msg);
+        }
+    }
+
+    /* "ADPULL <origin> <digest> ...": a peer lacks these ads of origin, named by
+     * EntryDigest (hex) in a refresh we passed on. Those we hold and would have
+     * forwarded go back through its outbox. */
+    void
+    RIBAdStore::HandleAdPull(Ptr<Socket> socket, Address from, std::string& msg)
+    {
+        RIB *rib = (RIB *)(this->parent_ctx);
+        Ipv4Address my_addr = Ipv4Address::ConvertFrom(rib->my_addr);
+
+        std::stringstream ss(msg);
+        std::string type, origin_str;
+        if (!(ss >> type >> origin_str)) {
+            return;
+        }
+        auto stored = m_byOrigin.find(Ipv4Address(origin_str.c_str()).Get());
+        if (stored == m_byOrigin.end()) {
+            return;
+        }
+
+        uint64_t digest;
+        ss >> std::hex;
+        while (ss >> digest) {
+            auto it = stored->second.find(digest);
+            if (it == stored->second.end()) {
+                continue;
+            }
+            NameDBEntry* entry = it->second;
+            bool forwardable = entry->origin_AS_addr == my_addr ? !entry->trust_cert.issuer.empty() : entry->edges_retained;
+            if (forwardable) {
+                EnqueueAd(socket, entry, SerializeAd(entry), from);
+            }
+        }
+    }
+
+    // Drops the seen-cache entry of an ad we no longer hold, so a repaired copy is taken back
+    void
+    RIBAdStore::ForgetSeen(NameDBEntry* entry)
+    {
+        Ptr<Packet> p = Create<Packet>(0);
+        p->AddHeader(entry->ToAdvertisementHeader());
+        AdvertisementDigestHeader digestHeader;
+        p->PeekHeader(digestHeader);
+        if (digestHeader.IsValid()) {
+            m_seenCache.Erase(digestHeader.GetDigest());
+        }
+    }
+
+    /* Refresh chunks wait in the peer's outbox with its ads and go out after
+     * them on the next flush. A newer epoch of an origin replaces the chunks of
+     * older ones still waiting. */
+    void
+    RIBAdStore::EnqueueRefresh(Ptr<Socket> socket, Address dest, uint32_t origin, uint32_t epoch, uint32_t chunk, const std::string& msg)
+    {
+        RIB *rib = (RIB *)(this->parent_ctx);
+        RIBPeerTable::Peer* peer = rib->peers.Find(dest);
+        if (!peer) {
+            socket->SendTo(Create<Packet>((const uint8_t *)msg.c_str(), msg.size()), 0, dest);
+            return;
+        }
+        RIBPeerTable::Peer& outbox = *peer;
+        outbox.socket = socket;
+
+        auto& pending = outbox.pendingRefresh;
+        for (auto it = pending.lower_bound(std::make_pair(origin, 0u)); it != pending.end() && it->first.first == origin;) {
+            if (it->second.first < epoch) {
+                it = pending.erase(it);
+            } else {
+                ++it;
+            }
+        }
+        pending[std::make_pair(origin, chunk)] = std::make_pair(epoch, msg);
+        ScheduleFlush(outbox.flushEvent, outbox.nextAllowed, dest);
+    }
+
+    // Stored ads by origin and EntryDigest, so refreshes touch only the ads they name
+    void
+    RIBAdStore::IndexAd(NameDBEntry* entry)
+    {
+        m_byOrigin[entry->origin_AS_addr.Get()][EntryDigest(*entry)] = entry;
+    }
+
+    void
+    RIBAdStore::UnindexAd(NameDBEntry* entry)
+    {
+        auto it = m_byOrigin.find(entry->origin_AS_addr.Get());
+        if (it == m_byOrigin.end()) {
+            return;
+        }
+        auto indexed = it->second.find(EntryDigest(*entry));
+        if (indexed != it->second.end() && indexed->second == entry) {
+            it->second.erase(indexed);
+        }
+        if (it->second.empty()) {
+            m_byOrigin.erase(it);
+        }
+    }
+
+    Ptr<Packet>
+    RIBAdStore::SerializeAd(NameDBEntry* entry)
+    {
+        if (m_binaryAds) {
+            Ptr<Packet> p = Create<Packet>(0);
+            p->AddHeader(entry->ToAdvertisementHeader());
+            return p;
+        }
+        std::string content = entry->ToAdvertisementStr();
+        return Create<Packet>((const uint8_t *)content.c_str(), content.size());
+    }
+
+    /* MRAI-style pacing: ads to a peer wait in its outbox until the peer's
+     * advertisement interval has passed since the last flush. Within one
+     * interval only the latest (newest seq, then shortest path) ad or withdrawal
+     * per (name, origin) is kept.
+     * On flush the outbox is packed into datagrams of up to BatchMtu bytes:
+     *   [SeqTsHeader] u8 AD_BATCH_MAGIC | u8 version | u16 count | { u16 len | ad }*  */
+    void
+    RIBAdStore::EnqueueAd(Ptr<Socket> socket, NameDBEntry* entry, Ptr<Packet> content, Address dest)
+    {
+        RIB *rib = (RIB *)(this->parent_ctx);
+        RIBPeerTable::Peer* peer = rib->peers.Find(dest);
+        if (!peer) {
+            // * not a peering session, nothing to pace
+            ForwardAds(socket, content, dest);
+            m_stats.adsSent++;
+            return;
+        }
+        RIBPeerTable::Peer& outbox = *peer;
+        outbox.socket = socket;
+
+        auto key = std::make_pair(entry->dc_name, entry->origin_AS_addr.Get());
+        auto it = outbox.pending.find(key);
+        if (it == outbox.pending.end()) {
+            outbox.pending[key] = RIBPeerTable::PendingAd{entry->seq, (uint32_t)entry->td_path.size(), content};
+        } else if (entry->seq > it->second.seq
+                   || (entry->seq == it->second.seq && entry->td_path.size() < it->second.pathLength)) {
+            it->second = RIBPeerTable::PendingAd{entry->seq, (uint32_t)entry->td_path.size(), content};
+        }
+        ScheduleFlush(outbox.flushEvent, outbox.nextAllowed, dest);
+    }
+
+    void
+    RIBAdStore::ScheduleFlush(EventId& flushEvent, Time nextAllowed, Address dest)
+    {
+        if (!flushEvent.IsRunning()) {
+            Time delay = m_batchFlushInterval;
+            if (nextAllowed > Simulator::Now() + delay) {
+                delay = nextAllowed - Simulator::Now();
+            }
+            flushEvent = Simulator::Schedule(delay, &RIBAdStore::FlushAds, this, dest);
+        }
+    }
+
+    void
+    RIBAdStore::FlushAds(Address dest)
+    {
+        RIB *rib = (RIB *)(this->parent_ctx);
+        RIBPeerTable::Peer* peer = rib->peers.Find(dest);
+        if (!peer || (peer->pending.empty() && peer->pendingRefresh.empty())) {
+            return;
+        }
+        RIBPeerTable::Peer& outbox = *peer;
+
+        std::vector<Ptr<Packet>> batch;
+        uint32_t bytes = 4;
+        for (auto& x : outbox.pending) {
+            Ptr<Packet> ad = x.second.ad;
+            if (m_batchMtu == 0) {
+                ForwardAds(outbox.socket, ad, dest);
+                continue;
+            }
+            if (!batch.empty() && bytes + 2 + ad->GetSize() > m_batchMtu) {
+                ForwardAds(outbox.socket, BuildAdBatch(batch), dest);
+                batch.clear();
+                bytes = 4;
+            }
+            batch.push_back(ad);
+            bytes += 2 + ad->GetSize();
+        }
+        if (!batch.empty()) {
+            ForwardAds(outbox.socket, BuildAdBatch(batch), dest);
+        }
+        m_stats.adsSent += outbox.pending.size();
+        outbox.adsSent += outbox.pending.size();
+        NS_LOG_INFO("Flushed " << outbox.pending.size() << " ads to " << InetSocketAddress::ConvertFrom(dest).GetIpv4());
+        outbox.pending.clear();
+
+        // * after the ads, so a new ad is never refreshed before it arrives
+        for (auto& x : outbox.pendingRefresh) {
+            const std::string& msg = x.second.second;
+            outbox.socket->SendTo(Create<Packet>((const uint8_t *)msg.c_str(), msg.size()), 0, dest);
+        }
+        outbox.pendingRefresh.clear();
+
+        // BGP-style jitter: the next interval is 75-100% of the configured one
+        outbox.nextAllowed = Simulator::Now() + m_mrai * m_rng->GetValue(0.75, 1.0);
+    }
+
+    Ptr<Packet>
+    RIBAdStore::BuildAdBatch(const std::vector<Ptr<Packet>>& ads)
+    {
+        uint8_t batchHeader[4] = {AD_BATCH_MAGIC, 1, (uint8_t)(ads.size() >> 8), (uint8_t)(ads.size() & 0xff)};
+        Ptr<Packet> batch = Create<Packet>(batchHeader, 4);
+        for (auto& ad : ads) {
+            uint8_t len[2] = {(uint8_t)(ad->GetSize() >> 8), (uint8_t)(ad->GetSize() & 0xff)};
+            batch->AddAtEnd(Create<Packet>(len, 2));
+            batch->AddAtEnd(ad);
+        }
+        return batch;
+    }
+
+    int64_t
+    RIBAdStore::AssignStreams(int64_t stream)
+    {
+        m_rng->SetStream(stream);
+        return 1;
+    }
+
+    std::vector<Ptr<Packet>>
+    RIBAdStore::SplitAdBatch(Ptr<Packet> packet)
+    {
+        uint8_t batchHeader[4];
+        if (packet->GetSize() < 4 || packet->CopyData(batchHeader, 4) < 4 || batchHeader[0] != AD_BATCH_MAGIC) {
+            return std::vector<Ptr<Packet>>{ packet };
+        }
+
+        std::vector<Ptr<Packet>> ads;
+        uint16_t count = (batchHeader[2] << 8) | batchHeader[3];
+        packet->RemoveAtStart(4);
+        for (uint16_t k = 0; k < count && packet->GetSize() >= 2; k++) {
+            uint8_t len[2];
+            packet->CopyData(len, 2);
+            packet->RemoveAtStart(2);
+            uint32_t adSize = (len[0] << 8) | len[1];
+            if (adSize > packet->GetSize()) {
+                NS_LOG_WARN("Truncated ad batch, dropping the rest");
+                break;
+            }
+            // Fragments share the received buffer, no copy of the ad bytes
+            ads.push_back(packet->CreateFragment(0, adSize));
+            packet->RemoveAtStart(adSize);
+        }
+        return ads;
+    }
+
+    void
+    RIBAdStore::ForwardAds(Ptr<Socket> socket, Ptr<Packet> content, Address dest) {
+        // Need to add header because the same type of header is alwasy striped down on the HandleRead() side
+        SeqTsHeader seqTS;  //! not initialized, do we care sequence number and timestamp?
+        Ptr<Packet> p = Create<Packet>(0); // 8+4 : the size of the seqTs header
+        p->AddHeader(seqTS);
+        p->AddAtEnd(content);
+        NS_LOG_INFO("> Sent " << socket->SendTo(p, 0, dest));
+    }
+
+    void
+    RIBAdStore::HandleRead(Ptr<Socket> socket)
+    {
+        NS_LOG_FUNCTION(this << socket);
+        Ptr<Packet> packet;
+        Address from;
+        Address localAddress;
+        while ((packet = socket->RecvFrom(from)))
+        {
+            socket->GetSockName(localAddress);
+            m_rxTrace(packet);
+            m_rxTraceWithAddresses(packet, from, localAddress);
+            if (packet->GetSize() > 0)
+            {
+                // uint32_t receivedSize = packet->GetSize();
+                // SeqTsHeader seqTs;
+                // packet->RemoveHeader(seqTs);
+
+                std::stringstream ss;
+                packet->CopyData(&ss, packet->GetSize());
+                std::string ad(ss.str());
+
+                
+                if (ad.substr(0, 12) == "GIVESWITCHES") {
+                    // "GIVESWITCHES <version>" is answered without queueing when nothing changed
+                    RIB *rib = (RIB *)(this->parent_ctx);
+                    uint32_t since;
+                    uint32_t version = rib->linkManager->GetSwitchVersion();
+                    if (MemberList::ParseSince(ad, 12, since) && version <= since) {
+                        std::string resp = MemberList::NotModified(version);
+                        socket->SendTo(Create<Packet>((const uint8_t *)resp.data(), resp.size()), 0, from);
+                        continue;
+                    }
+                    HandleQuery(socket, from, "GIVESWITCHES");
+                    continue;
+                }
+
+                if (ad.substr(0, 7) == "GIVEADS") {
+                    HandleQuery(socket, from, ad);
+                    continue;
+                }
+
+                if (ad.substr(0, 3) == "SUM") {
+                    HandleSummary(socket, from, ad);
+                    continue;
+                }
+
+                if (ad.substr(0, 8) == "REFRESH ") {
+                    HandleServerRefresh(socket, from, ad);
+                    continue;
+                }
+
+                if (ad.substr(0, 10) == "ADREFRESH ") {
+                    HandleRefresh(socket, from, ad);
+                    continue;
+                }
+
+                if (ad.substr(0, 7) == "ADPULL ") {
+                    HandleAdPull(socket, from, ad);
+                    continue;
+                }
+
+                if (ad.substr(0, 11) == "GOSSIPPULL ") {
+                    HandlePull(socket, from, ad);
+                    continue;
+                }
+
+                if (ad.substr(0, 6) == "ADREQ ") {
+                    HandleResolve(socket, from, ad);
+                    continue;
+                }
+
+                if (ad.substr(0, 9) == "SHARDADS\n") {
+                    HandleShardAds(ad);
+                    continue;
+                }
+
+                if (ad.substr(0, 5) == "NACK:") {
+                    // * Ads are never shed, a NACK here is for a query we did not send
+                    continue;
+                }
+
+                // * Remove header
+                uint32_t receivedSize = packet->GetSize();
+                SeqTsHeader seqTs;
+                packet->RemoveHeader(seqTs);
+
+                uint32_t currentSequenceNumber = seqTs.GetSeq();
+                if (InetSocketAddress::IsMatchingType(from))
+                {
+                    NS_LOG_INFO("TraceDelay: RX " << receivedSize << " bytes from "
+                                                << InetSocketAddress::ConvertFrom(from).GetIpv4()
+                                                << " Sequence Number: " << currentSequenceNumber
+                                                << " Uid: " << packet->GetUid() << " TXtime: "
+                                                << seqTs.GetTs() << " RXtime: " << Simulator::Now()
+                                                << " Delay: " << Simulator::Now() - seqTs.GetTs());
+                }
+                else if (Inet6SocketAddress::IsMatchingType(from))
+                {
+                    NS_LOG_INFO("TraceDelay: RX " << receivedSize << " bytes from "
+                                                << Inet6SocketAddress::ConvertFrom(from).GetIpv6()
+                                                << " Sequence Number: " << currentSequenceNumber
+                                                << " Uid: " << packet->GetUid() << " TXtime: "
+                                                << seqTs.GetTs() << " RXtime: " << Simulator::Now()
+                                                << " Delay: " << Simulator::Now() - seqTs.GetTs());
+                }
+
+                m_lossCounter.NotifyReceived(currentSequenceNumber);
+                m_received++;
+
+                // * A datagram from a peer RIB may carry a batch of ads, each one is a separate request
+                RIB *rib = (RIB *)(this->parent_ctx);
+                std::vector<Ptr<Packet>> adPackets = SplitAdBatch(packet);
+                RIBPeerTable::Peer* peer = rib->peers.Find(from);
+                if (peer) {
+                    peer->lastHeard = Simulator::Now();
+                    peer->adsReceived += adPackets.size();
+
+                    // * Smoothed like TCP's SRTT, feeds the latency ranking of ads.
+                    // Only inter-TD hops count, our own DC servers are one LAN hop away
+                    if (InetSocketAddress::IsMatchingType(from)) {
+                        Time delay = Simulator::Now() - seqTs.GetTs();
+                        auto measured = m_peerDelay.find(InetSocketAddress::ConvertFrom(from).GetIpv4().Get());
+                        if (measured == m_peerDelay.end()) {
+                            m_peerDelay[InetSocketAddress::ConvertFrom(from).GetIpv4().Get()] = delay;
+                        } else {
+                            measured->second = (measured->second * (int64_t)7 + delay) / (int64_t)8;
+                        }
+                    }
+                }
+                for (auto& adPacket : adPackets) {
+                    // * Queued, never shed, see RIBServiceQueue::IsSheddable
+                    rib->serviceQueue->Submit(RIBServiceQueue::OP_AD, [this, socket, adPacket, from]() { ProcessAd(socket, adPacket, from); });
+                }
+            }
+        }
+    }
+
+    void
+    RIBAdStore::ProcessAd(Ptr<Socket> socket, Ptr<Packet> packet, Address from)
+    {
+        uint32_t receivedSize = packet->GetSize();
+
+        RIB *rib = (RIB *)(this->parent_ctx);
+        NameDBEntryPtr owned_entry;
+
+        // * deserialize the advertisement packet, binary ads start with the magic byte, JSON ones with '{'
+        uint8_t first_byte = 0;
+        packet->CopyData(&first_byte, 1);
+        AdvertisementDigestHeader digestHeader;
+        if (first_byte == AdvertisementHeader::MAGIC) {
+            // * Flooded copies of an ad we already took are dropped on a hash lookup
+            packet->PeekHeader(digestHeader);
+            if (digestHeader.IsValid() && Ipv4Address(digestHeader.GetDigest().origin_AS) != Ipv4Address::ConvertFrom(rib->my_addr)
+                && m_seenCache.IsDuplicate(digestHeader.GetDigest())) {
+                NS_LOG_INFO("Dropping duplicate ad: " << digestHeader);
+                m_duplicateAdTrace(packet);
+                m_stats.adsRedundant++;
+                return;
+            }
+
+            AdvertisementHeader adHeader;
+            packet->RemoveHeader(adHeader);
+            NS_LOG_INFO("" << Ipv4Address::ConvertFrom(rib->my_addr) <<  " received: " << adHeader);
+            owned_entry = NameDBEntry::FromAdvertisementHeader(adHeader, entryPool);
+            if (!owned_entry) {
+                NS_LOG_ERROR("Cannot parse binary ad of " << receivedSize << " bytes");
+                return;
+            }
+        } else {
+            std::stringstream ss;
+            packet->CopyData(&ss, packet->GetSize());
+            std::string ad = ss.str();
+            // * printout the received packet body
+            // NS_LOG_INFO("I am ribadstore at " << Ipv4Address::ConvertFrom(rib->my_addr));
+            NS_LOG_INFO("" << Ipv4Address::ConvertFrom(rib->my_addr) <<  " received: " << ad);
+            owned_entry = NameDBEntry::FromAdvertisementStr(ad, entryPool);
+            if (!owned_entry) {
+                NS_LOG_ERROR("Cannot parse ads: " << ad);
+                // std::abort();
+                return;
+            }
+        }
+
+        // Rejected entries go back to the pool when owned_entry goes out of scope;
+        // accepted ones are owned by db and only observed through advertised_entry
+        NameDBEntry* advertised_entry = owned_entry.get();
+
+        // check if self is already in advertisement path to avoid loop
+        bool is_loop = false;
+        Ipv4Address my_addr = Ipv4Address::ConvertFrom(rib->my_addr);
+        for (auto addr : advertised_entry->td_path) {
+            if (addr == my_addr) {
+                is_loop = true;
+                break;
+            }
+        }
+        if (is_loop) {
+            NS_LOG_INFO("Detected advertising loop, ignoring current ads...");
+            m_stats.adsRedundant++;
+            return;
+        }
+
+        if (advertised_entry->withdrawn) {
+            if (ApplyWithdrawal(socket, std::move(owned_entry), from) && digestHeader.IsValid()) {
+                m_seenCache.Insert(digestHeader.GetDigest());
+            }
+            return;
+        }
+
+        // If I am not the origin AS and the ad is forwarded from someone not in my peer,
+        // Drop it before it reaches db
+        bool is_origin_AS_for_curr_ad = advertised_entry->origin_AS_addr == my_addr;
+        if (!is_origin_AS_for_curr_ad){
+            if (advertised_entry->td_path.empty()) return;
+            if (!rib->peers.Find(advertised_entry->td_path[advertised_entry->td_path.size() - 1])){
+                NS_LOG_INFO("Potentially malicious advertisement. No changes made to trust relations. Dropping...");
+                return;
+            }
+        }
+
+        // * Ads of our own servers are numbered here, each one replaces the previous
+        if (advertised_entry->origin_AS_addr == my_addr && advertised_entry->td_path.empty()) {
+            advertised_entry->seq = ++m_originSeq[advertised_entry->dc_name];
+        }
+        advertised_entry->latency = EstimateLatency(*advertised_entry);
+
+        bool updated = UpdateNameCache(std::move(owned_entry));
+        if (updated && digestHeader.IsValid()) {
+            m_seenCache.Insert(digestHeader.GetDigest());
+        }
+        if (updated) {
+            m_nameIndex.Insert(QualifiedName(*advertised_entry));
+            ScheduleExpiry(advertised_entry);
+            m_stats.adsAccepted++;
+            m_stats.lastUpdate = Simulator::Now();
+        } else {
+            m_stats.adsRedundant++;
+        }
+
+        NS_LOG_INFO("Number of ads: " << db.size());
+
+        NS_LOG_INFO("7123870127491273901275649604917284912074891274912749812");
+
+        if (updated) {
+            // add itself to the td_path of the advertisement
+            if (!advertised_entry->td_path.push_back(my_addr)) {
+                NS_LOG_INFO("Advertisement path is full, not forwarding further");
+                return;
+            }
+            Ptr<Packet> serialized = SerializeAd(advertised_entry);
+
+            // (trust related) if current AS is the origin AS, don't forward if no certificate about 
+            // the origin server from the data capsule owner
+            bool trust_curr_AS = false;
+
+            // for (auto it = trust_relation_map.begin(); it != trust_relation_map.end(); it ++) {
+            //     NS_LOG_INFO("issuer: " << it->first << ", entity: " << it->second.first << ", type: " << it->second.second);
+            // }
+            if (is_origin_AS_for_curr_ad) {
+                // check if some DC owner trusts the origin server with this name
+                const RIBCertStore::OwnerTrust* owner_trust = rib->certStore->FindOwnerTrust(advertised_entry->dc_name, advertised_entry->origin_server);
+                if (owner_trust) {
+                    trust_curr_AS = true;
+                    // * Attach trust from DC owner to current name to the advertisement
+                    advertised_entry->trust_cert.issuer = owner_trust->issuer;
+                    advertised_entry->trust_cert.entity = owner_trust->entity;
+                    advertised_entry->trust_cert.r_transitivity = owner_trust->r_transitivity;
+                    advertised_entry->trust_cert.type = "trust";
+                    // * Attach distrust relations of the DC owner
+                    auto& distrust_relation_map = rib->certStore->distrustRelations;
+                    auto [range_start, range_stop] = distrust_relation_map.equal_range(owner_trust->issuer);
+                    for (auto it = range_start; it != range_stop; ++it) {
+                        advertised_entry->distrust_certs.push_back(
+                            NameDBEntry::DistrustCert {"distrust", it->second, it->first}
+                        );
+                    }
+                    serialized = SerializeAd(advertised_entry);
+                    // now qualified by its owner; the bare key is dropped on its next lookup
+                    m_nameIndex.Insert(QualifiedName(*advertised_entry));
+                }
+            }
+            // if is_origin_AS_for_curr_ad, only forward if trust relation exist between DC owner and the DC server in my domain
+            // otherwise, flooding as usual
+            if (trust_curr_AS&&is_origin_AS_for_curr_ad) {
+                NS_LOG_INFO("I am origin AS, trust relationship exist, so forwarding ads to my peer.....");
+            }
+            if (!trust_curr_AS&&is_origin_AS_for_curr_ad) {
+                NS_LOG_INFO("I am origin AS, trust relationship does not exist, thus dropping this advertisement from the DC server advertiser.....");
+            }
+            
+            // save the received trust and distrust relations in local ribcertstore cache
+            if (!is_origin_AS_for_curr_ad) {
+                // * if not empty trust relation, add to cache
+                if ( !(advertised_entry->trust_cert.issuer.size() == 0
+                    && advertised_entry->trust_cert.entity.size() == 0
+                    && advertised_entry->trust_cert.r_transitivity == 0) ) {
+                        rib->certStore->InsertTrust(advertised_entry->trust_cert.issuer, advertised_entry->trust_cert.entity, advertised_entry->trust_cert.r_transitivity);
+                        rib->certStore->InsertTrust(advertised_entry->trust_cert.entity, advertised_entry->trust_cert.issuer, INT_MAX);
+                }
+
+                if (advertised_entry->distrust_certs.size() != 0) {
+                    for (auto& item : advertised_entry->distrust_certs) {
+                        rib->certStore->InsertDistrust(item.issuer, item.entity);
+                    }
+                }
+
+                // Include the td_path and DCServer -> TD map in trust relations, Otherwise the graph is not complete.
+                // They are held for as long as this ad is stored.
+                RetainAdEdges(advertised_entry);
+            }
+
+            if (m_summaryMode) {
+                // * Only the name goes into our summary; others fetch the ad when they need it
+                if (is_origin_AS_for_curr_ad) {
+                    if (trust_curr_AS) {
+                        AddToSummary(advertised_entry->dc_name);
+                    }
+                } else {
+                    ForwardResolved(socket, advertised_entry, serialized);
+                }
+                return;
+            }
+
+            if ((trust_curr_AS&&is_origin_AS_for_curr_ad) || !is_origin_AS_for_curr_ad) {
+                std::vector<Address> dests;
+                for (auto& peer : rib->peers) {
+                    //   cases not to forward:
+                    //     1. the destination is what this ads came from
+                    //     2. the destination is the origin AS
+                    //     3. ...
+                    Address dest_socket = InetSocketAddress(Ipv4Address::ConvertFrom(peer.addr), RIBADSTORE_PORT);   
+                    if (dest_socket != from && peer.addr != advertised_entry->origin_AS_addr) {
+                        dests.push_back(dest_socket);
+                    }
+                }
+                SelectGossipPeers(dests);
+                for (auto& dest_socket : dests) {
+                    std::stringstream ss;
+                    my_addr.Print(ss);
+                    NS_LOG_INFO("RIB:" << ss.str() << ". Forward Ads to " << InetSocketAddress::ConvertFrom(dest_socket).GetIpv4());
+                    EnqueueAd(socket, advertised_entry, serialized, dest_socket);
+                }
+            }
+            
+        }
+
+        NS_LOG_INFO("ajsdfoijaofweifn,dasnf,masdnfm,asnfd,mnasd,fnwefiowe");
     }
 
 }
\ No newline at end of file
@@ -7,6 +7,18 @@ namespace ns3
 
     NS_OBJECT_ENSURE_REGISTERED(RIBCertStore);
 
+    static bool
+    ParseIpv4(const std::string& str, Ipv4Address& addr)
+    {
+        unsigned int a, b, c, d;
+        char extra;
+        if (sscanf(str.c_str(), "%u.%u.%u.%u%c", &a, &b, &c, &d, &extra) != 4 || a > 255 || b > 255 || c > 255 || d > 255){
+            return false;
+        }
+        addr = Ipv4Address((a << 24) | (b << 16) | (c << 8) | d);
+        return true;
+    }
+
     TypeId
     RIBCertStore::GetTypeId()
     {
@@ -28,6 +40,11 @@ namespace ns3
                             MakeUintegerAccessor(&RIBCertStore::GetPacketWindowSize,
                                                 &RIBCertStore::SetPacketWindowSize),
                             MakeUintegerChecker<uint16_t>(8, 256))
+                .AddAttribute("AntiEntropyInterval",
+                            "Time between Merkle digest exchanges with peering RIBs. Zero disables anti-entropy.",
+                            TimeValue(Seconds(10.0)),
+                            MakeTimeAccessor(&RIBCertStore::m_antiEntropyInterval),
+                            MakeTimeChecker())
                 .AddTraceSource("Rx",
                                 "A packet has been received",
                                 MakeTraceSourceAccessor(&RIBCertStore::m_rxTrace),
@@ -44,6 +61,7 @@ namespace ns3
     {
         NS_LOG_FUNCTION(this);
         m_received = 0;
+        m_fromShard = false;
         // parent_ctx = ctx;
     }
 
@@ -124,12 +142,16 @@ namespace ns3
 
         m_socket6->SetRecvCallback(MakeCallback(&RIBCertStore::HandleRead, this));
 
+        if (m_antiEntropyInterval.IsStrictlyPositive()){
+            m_antiEntropyEvent = Simulator::Schedule(m_antiEntropyInterval, &RIBCertStore::AntiEntropy, this);
+        }
     }
 
     void
     RIBCertStore::StopApplication()
     {
         NS_LOG_FUNCTION(this);
+        Simulator::Cancel(m_antiEntropyEvent);
 
         if (m_socket)
         {
@@ -150,93 +172,539 @@ namespace ns3
             m_rxTrace(packet);
             m_rxTraceWithAddresses(packet, from, localAddress);
             if (packet->GetSize() > 0){
-                SeqTsHeader seqTs;
-                packet->RemoveHeader(seqTs);
-                uint32_t currentSequenceNumber = seqTs.GetSeq();
-                uint32_t receivedSize = packet->GetSize();
-
-                /* Packet contents:
-                 * {
-                 *       "issuer": "DCOwnerName:DCName | ClientName",
-                 *       "type": "trust | distrust",
-                 *       "entity": "entity to trust/distrust",
-                 *       "r_transitivity": value
-                 * } 
-                 */
-
-                std::stringstream ss;
-                packet->CopyData(&ss, packet->GetSize());
-                std::string data = ss.str();
-                Json::Reader jsonReader;
-                Json::Value jsonData;
-                if (!jsonReader.parse(data, jsonData)){
-                    NS_LOG_INFO("Malformed JSON");
+                std::stringstream raw;
+                packet->CopyData(&raw, packet->GetSize());
+                std::string cmd = raw.str();
+                if (cmd.substr(0, 5) == "NACK:"){
+                    // * Cert sync is never shed, a NACK here is for a query we did not send
                     continue;
                 }
-
-                if (!(
-                    jsonData.isMember("issuer") &&
-                    jsonData.isMember("type") &&
-                    jsonData.isMember("entity")
-                )){
-                    NS_LOG_INFO("Malformed JSON");
+                if (cmd.substr(0, 10) == "SHARDCERT\n"){
+                    // * Replication within the TD is not client load, it bypasses the service queue
+                    HandleShardCerts(cmd);
                     continue;
                 }
+                RIBServiceQueue::Opcode op = (cmd.substr(0, 6) == "AESYNC" || cmd.substr(0, 6) == "AELEAF")
+                    ? RIBServiceQueue::OP_ANTIENTROPY : RIBServiceQueue::OP_CERT;
 
-                if (jsonData["type"].asString() == "trust"){
-                    if (!jsonData.isMember("r_transitivity")){
-                        jsonData["r_transitivity"] = INT_MAX;
-                    }
-                }
-                
-                NS_LOG_INFO("JSON Parsed Successfully");
-                if (jsonData["type"].asString() == "trust"){
-                    std::pair<std::string, int> __val = std::make_pair(jsonData["entity"].asString(), jsonData["r_transitivity"].asInt());
-                    trustRelations.insert(std::make_pair(
-                        jsonData["issuer"].asString(), __val));
-                    
-                    if (jsonData["issuer"].asString().find(":") != std::string::npos){
-                        std::pair<std::string, int> __val2 = std::make_pair(jsonData["issuer"].asString(), INT_MAX);
-                        trustRelations.insert(std::make_pair(jsonData["entity"].asString(), __val2));
-                    }
-                }else if (jsonData["type"].asString() == "distrust"){
-                    distrustRelations.insert(std::make_pair(
-                        jsonData["issuer"].asString(), jsonData["entity"].asString()));
-                }
+                RIB *rib = (RIB *)parent_ctx;
+                rib->serviceQueue->Submit(op, [this, socket, packet, from]() { ProcessCert(socket, packet, from); });
+            }
+        }
+    }
 
-                for (auto &x: trustRelations){
-                    NS_LOG_INFO("AS" << ((RIB *)parent_ctx)->td_num << ": Trust Relation: " << x.first << " "
-                        << x.second.first << " " << x.second.second);
-                }
+    void
+    RIBCertStore::ProcessCert(Ptr<Socket> socket, Ptr<Packet> packet, Address from)
+    {
+        std::stringstream raw;
+        packet->CopyData(&raw, packet->GetSize());
+        std::string cmd = raw.str();
+        if (cmd.substr(0, 6) == "AESYNC"){
+            HandleSync(socket, from, cmd);
+            return;
+        }
+        if (cmd.substr(0, 6) == "AELEAF"){
+            HandleLeaf(socket, from, cmd);
+            return;
+        }
 
-                for (auto &x: distrustRelations){
-                    NS_LOG_INFO("Distrust Relation: " << x.first << " " << x.second);
-                }
+        SeqTsHeader seqTs;
+        packet->RemoveHeader(seqTs);
+        uint32_t currentSequenceNumber = seqTs.GetSeq();
+        uint32_t receivedSize = packet->GetSize();
 
+        /* Packet contents:
+         * {
+         *       "issuer": "DCOwnerName:DCName | ClientName",
+         *       "type": "trust | distrust",
+         *       "entity": "entity to trust/distrust",
+         *       "r_transitivity": value
+         * } 
+         */
 
-                if (InetSocketAddress::IsMatchingType(from))
-                {
-                    NS_LOG_INFO("TraceDelay: RX " << receivedSize << " bytes from "
-                                                << InetSocketAddress::ConvertFrom(from).GetIpv4()
-                                                << " Sequence Number: " << currentSequenceNumber
-                                                << " Uid: " << packet->GetUid() << " TXtime: "
-                                                << seqTs.GetTs() << " RXtime: " << Simulator::Now()
-                                                << " Delay: " << Simulator::Now() - seqTs.GetTs());
-                }
-                else if (Inet6SocketAddress::IsMatchingType(from))
-                {
-                    NS_LOG_INFO("TraceDelay: RX " << receivedSize << " bytes from "
-                                                << Inet6SocketAddress::ConvertFrom(from).GetIpv6()
-                                                << " Sequence Number: " << currentSequenceNumber
-                                                << " Uid: " << packet->GetUid() << " TXtime: "
-                                                << seqTs.GetTs() << " RXtime: " << Simulator::Now()
-                                                << " Delay: " << Simulator::Now() - seqTs.GetTs());
+        std::stringstream ss;
+        packet->CopyData(&ss, packet->GetSize());
+        std::string data = ss.str();
+        Json::Reader jsonReader;
+        Json::Value jsonData;
+        if (!jsonReader.parse(data, jsonData)){
+            NS_LOG_INFO("Malformed JSON");
+            return;
+        }
+
+        if (!(
+            jsonData.isMember("issuer") &&
+            jsonData.isMember("type") &&
+            jsonData.isMember("entity")
+        )){
+            NS_LOG_INFO("Malformed JSON");
+            return;
+        }
+
+        if (jsonData["type"].asString() == "trust"){
+            if (!jsonData.isMember("r_transitivity")){
+                jsonData["r_transitivity"] = INT_MAX;
+            }
+        }
+        
+        NS_LOG_INFO("JSON Parsed Successfully");
+        if (jsonData["type"].asString() == "trust"){
+            InsertTrust(jsonData["issuer"].asString(), jsonData["entity"].asString(), jsonData["r_transitivity"].asInt());
+            
+            if (jsonData["issuer"].asString().find(":") != std::string::npos){
+                InsertTrust(jsonData["entity"].asString(), jsonData["issuer"].asString(), INT_MAX);
+            }
+        }else if (jsonData["type"].asString() == "distrust"){
+            InsertDistrust(jsonData["issuer"].asString(), jsonData["entity"].asString());
+        }
+
+        for (auto &x: trustRelations){
+            NS_LOG_INFO("AS" << ((RIB *)parent_ctx)->td_num << ": Trust Relation: " << x.first << " "
+                << x.second.first << " " << x.second.second);
+        }
+
+        for (auto &x: distrustRelations){
+            NS_LOG_INFO("Distrust Relation: " << x.first << " " << x.second);
+        }
+
+
+        if (InetSocketAddress::IsMatchingType(from))
+        {
+            NS_LOG_INFO("TraceDelay: RX " << receivedSize << " bytes from "
+                                        << InetSocketAddress::ConvertFrom(from).GetIpv4()
+                                        << " Sequence Number: " << currentSequenceNumber
+                                        << " Uid: " << packet->GetUid() << " TXtime: "
+                                        << seqTs.GetTs() << " RXtime: " << Simulator::Now()
+                                        << " Delay: " << Simulator::Now() - seqTs.GetTs());
+        }
+        else if (Inet6SocketAddress::IsMatchingType(from))
+        {
+            NS_LOG_INFO("TraceDelay: RX " << receivedSize << " bytes from "
+                                        << Inet6SocketAddress::ConvertFrom(from).GetIpv6()
+                                        << " Sequence Number: " << currentSequenceNumber
+                                        << " Uid: " << packet->GetUid() << " TXtime: "
+                                        << seqTs.GetTs() << " RXtime: " << Simulator::Now()
+                                        << " Delay: " << Simulator::Now() - seqTs.GetTs());
+        }
+
+        m_lossCounter.NotifyReceived(currentSequenceNumber);
+        m_received++;
+    }
+
+
+    bool
+    RIBCertStore::InsertTrust(const std::string& issuer, const std::string& entity, int r_transitivity)
+    {
+        std::stringstream cert;
+        cert << "T\t" << issuer << "\t" << entity << "\t" << r_transitivity;
+        // "me" only makes sense to this RIB, keep it out of the digest we share with peers
+        if (issuer != "me" && entity != "me"){
+            if (!m_certTree.Insert(cert.str())){
+                return false;
+            }
+        }
+
+        trustRelations.insert(std::make_pair(issuer, std::make_pair(entity, r_transitivity)));
+        // "me" is the whole TD to its shards
+        ShareWithShards(cert.str());
+
+        // Clients also issue "user:<id>" certs, those don't name a DataCapsule
+        size_t sep = issuer.find(":");
+        Ipv4Address server;
+        if (sep != std::string::npos && issuer.substr(0, sep) != "user" && ParseIpv4(entity, server)){
+            ownerIndex[CertName(issuer)].push_back(OwnerTrust{issuer, entity, server, r_transitivity});
+        }
+        return true;
+    }
+
+    // Name an owner cert is about: the dc name, or "<owner>:*" for a prefix cert
+    std::string
+    RIBCertStore::CertName(const std::string& issuer)
+    {
+        size_t sep = issuer.find(":");
+        if (sep == std::string::npos){
+            return "";
+        }
+        if (issuer.size() == sep + 2 && issuer[sep + 1] == '*'){
+            return issuer;
+        }
+        return issuer.substr(sep + 1);
+    }
+
+    const RIBCertStore::OwnerTrust*
+    RIBCertStore::FindOwnerTrust(const std::string& dc_name, const Ipv4Address& server) const
+    {
+        auto it = ownerIndex.find(dc_name);
+        if (it == ownerIndex.end()){
+            return nullptr;
+        }
+        for (auto &x: it->second){
+            if (x.server == server){
+                return &x;
+            }
+        }
+        return nullptr;
+    }
+
+    bool
+    RIBCertStore::InsertDistrust(const std::string& issuer, const std::string& entity)
+    {
+        if (issuer != "me" && entity != "me"){
+            if (!m_certTree.Insert("D\t" + issuer + "\t" + entity)){
+                return false;
+            }
+        }
+
+        distrustRelations.insert(std::make_pair(issuer, entity));
+        ShareWithShards("D\t" + issuer + "\t" + entity);
+        ((RIB *)parent_ctx)->pathComputer->NotifyRevocation();
+        if (((RIB *)parent_ctx)->adStore){
+            ((RIB *)parent_ctx)->adStore->NotifyDistrust(issuer, entity);
+        }
+        return true;
+    }
+
+    void
+    RIBCertStore::RetainAdEdge(const std::string& issuer, const std::string& entity)
+    {
+        if (adEdgeRefs[std::make_pair(issuer, entity)]++ > 0){
+            return;
+        }
+        auto [range_start, range_stop] = trustRelations.equal_range(issuer);
+        for (auto it = range_start; it != range_stop; ++it){
+            if (it->second.first == entity && it->second.second == INT_MAX){
+                return;
+            }
+        }
+        trustRelations.insert(std::make_pair(issuer, std::make_pair(entity, INT_MAX)));
+    }
+
+    void
+    RIBCertStore::ReleaseAdEdge(const std::string& issuer, const std::string& entity)
+    {
+        auto ref = adEdgeRefs.find(std::make_pair(issuer, entity));
+        if (ref == adEdgeRefs.end() || --ref->second > 0){
+            return;
+        }
+        adEdgeRefs.erase(ref);
+
+        // Still vouched for by a cert we hold, keep it
+        std::stringstream cert;
+        cert << "T\t" << issuer << "\t" << entity << "\t" << INT_MAX;
+        if (m_certTree.Contains(cert.str())){
+            return;
+        }
+
+        auto [range_start, range_stop] = trustRelations.equal_range(issuer);
+        for (auto it = range_start; it != range_stop; ++it){
+            if (it->second.first == entity && it->second.second == INT_MAX){
+                trustRelations.erase(it);
+                break;
+            }
+        }
+        ((RIB *)parent_ctx)->pathComputer->NotifyEdgeRemoved(issuer, entity);
+    }
+
+    /* Anti-entropy protocol (plain text, no SeqTs header):
+     *   "AESYNC <level> <index> <digest> [<level> <index> <digest> ...]"
+     *       Sender's digests for some tree nodes. The receiver answers with the
+     *       child digests of every node it disagrees on, so both sides walk down
+     *       only the differing subtrees.
+     *   "AELEAF <index> <want_reply>\n<cert>\n<cert>..."
+     *       All certs of a differing leaf. If want_reply is set, the receiver
+     *       sends back the certs of that leaf the sender did not have.
+     */
+    void
+    RIBCertStore::AntiEntropy()
+    {
+        m_antiEntropyEvent = Simulator::Schedule(m_antiEntropyInterval, &RIBCertStore::AntiEntropy, this);
+
+        RIB *rib = (RIB *)parent_ctx;
+        std::stringstream ss;
+        ss << "AESYNC 0 0 " << m_certTree.GetDigest(0, 0);
+        std::string msg = ss.str();
+
+        for (auto &peer: rib->peers){
+            Ptr<Packet> p = Create<Packet>((const uint8_t *)msg.c_str(), msg.size());
+            m_socket->SendTo(p, 0, InetSocketAddress(Ipv4Address::ConvertFrom(peer.addr), RIBCERTSTORE_PORT));
+        }
+    }
+
+    void
+    RIBCertStore::HandleSync(Ptr<Socket> socket, Address from, std::string& msg)
+    {
+        std::istringstream iss(msg.substr(6));
+        std::stringstream reply;
+        reply << "AESYNC";
+        bool descend = false;
+
+        uint32_t level, index;
+        uint64_t digest;
+        while (iss >> level >> index >> digest){
+            if (level > CertMerkleTree::DEPTH || index >= (1u << level)){
+                continue;
+            }
+            if (m_certTree.GetDigest(level, index) == digest){
+                continue;
+            }
+            if (level == CertMerkleTree::DEPTH){
+                SendLeaf(socket, from, index, true, nullptr);
+                continue;
+            }
+            for (uint32_t child = 2 * index; child <= 2 * index + 1; child++){
+                reply << " " << level + 1 << " " << child << " " << m_certTree.GetDigest(level + 1, child);
+            }
+            descend = true;
+        }
+
+        if (descend){
+            std::string resp = reply.str();
+            Ptr<Packet> p = Create<Packet>((const uint8_t *)resp.c_str(), resp.size());
+            socket->SendTo(p, 0, from);
+        }
+    }
+
+    void
+    RIBCertStore::HandleLeaf(Ptr<Socket> socket, Address from, std::string& msg)
+    {
+        std::istringstream iss(msg);
+        std::string line;
+        std::getline(iss, line);
+
+        std::istringstream header(line.substr(6));
+        uint32_t index;
+        int want_reply;
+        if (!(header >> index >> want_reply) || index >= (1u << CertMerkleTree::DEPTH)){
+            NS_LOG_INFO("Malformed AELEAF");
+            return;
+        }
+
+        std::set<std::string> theirs;
+        uint32_t learned = 0;
+        while (std::getline(iss, line)){
+            if (line.size() == 0){
+                continue;
+            }
+            theirs.insert(line);
+            if (MergeCert(line)){
+                learned++;
+            }
+        }
+        NS_LOG_INFO("AS" << ((RIB *)parent_ctx)->td_num << ": anti-entropy learned " << learned << " certs in leaf " << index);
+
+        if (want_reply){
+            SendLeaf(socket, from, index, false, &theirs);
+        }
+    }
+
+    void
+    RIBCertStore::SendLeaf(Ptr<Socket> socket, Address dest, uint32_t index, bool want_reply, const std::set<std::string>* except)
+    {
+        std::stringstream ss;
+        ss << "AELEAF " << index << " " << (want_reply ? 1 : 0) << "\n";
+        uint32_t cnt = 0;
+        for (auto &cert: m_certTree.GetLeaf(index)){
+            if (except && except->find(cert) != except->end()){
+                continue;
+            }
+            ss << cert << "\n";
+            cnt++;
+        }
+        if (cnt == 0 && !want_reply){
+            return;
+        }
+
+        std::string resp = ss.str();
+        Ptr<Packet> p = Create<Packet>((const uint8_t *)resp.c_str(), resp.size());
+        socket->SendTo(p, 0, dest);
+    }
+
+    bool
+    RIBCertStore::MergeCert(const std::string& cert)
+    {
+        std::vector<std::string> fields;
+        size_t start = 0;
+        size_t pos;
+        while ((pos = cert.find('\t', start)) != std::string::npos){
+            fields.push_back(cert.substr(start, pos - start));
+            start = pos + 1;
+        }
+        fields.push_back(cert.substr(start));
+
+        if (fields[0] == "T" && fields.size() == 4){
+            return InsertTrust(fields[1], fields[2], std::atoi(fields[3].c_str()));
+        }
+        if (fields[0] == "D" && fields.size() == 3){
+            return InsertDistrust(fields[1], fields[2]);
+        }
+        return false;
+    }
+
+    /* Certs inserted on one shard of the TD are pushed to the others, batched per
+     * simulator event and chunked to fit a datagram:
+     *   "SHARDCERT\n<cert>\n<cert>..."
+     * Certs a shard learns this way are not pushed on again. Inserts made before
+     * the store starts (snapshot loads) stay local, every shard loads its own. */
+    void
+    RIBCertStore::ShareWithShards(const std::string& cert)
+    {
+        RIB *rib = (RIB *)parent_ctx;
+        if (m_fromShard || !m_socket || rib->shards.Size() <= 1){
+            return;
+        }
+        m_shardCerts.push_back(cert);
+        if (!m_shardEvent.IsRunning()){
+            m_shardEvent = Simulator::ScheduleNow(&RIBCertStore::FlushShards, this);
+        }
+    }
+
+    void
+    RIBCertStore::FlushShards()
+    {
+        RIB *rib = (RIB *)parent_ctx;
+        size_t next = 0;
+        while (next < m_shardCerts.size()){
+            std::string msg = "SHARDCERT\n";
+            do {
+                msg += m_shardCerts[next++] + "\n";
+            } while (next < m_shardCerts.size() && msg.size() + m_shardCerts[next].size() < 1024);
+
+            for (size_t i = 0; i < rib->shards.Size(); i++){
+                if (rib->shards.GetShard(i) == rib->my_addr){
+                    continue;
                 }
+                Ptr<Packet> p = Create<Packet>((const uint8_t *)msg.c_str(), msg.size());
+                m_socket->SendTo(p, 0, InetSocketAddress(Ipv4Address::ConvertFrom(rib->shards.GetShard(i)), RIBCERTSTORE_PORT));
+            }
+        }
+        m_shardCerts.clear();
+    }
+
+    void
+    RIBCertStore::HandleShardCerts(std::string& msg)
+    {
+        std::istringstream iss(msg.substr(10));
+        std::string line;
+        uint32_t learned = 0;
+        m_fromShard = true;
+        while (std::getline(iss, line)){
+            if (line.size() > 0 && MergeCert(line)){
+                learned++;
+            }
+        }
+        m_fromShard = false;
+        NS_LOG_INFO("AS" << ((RIB *)parent_ctx)->td_num << ": learned " << learned << " certs from a shard");
+    }
 
-                m_lossCounter.NotifyReceived(currentSequenceNumber);
-                m_received++;
+    /* Snapshot: every cert in the Merkle tree, then the RIB-local "me" relations.
+     * Ad-derived edges are not stored, they come back with the ads. */
+    void
+    RIBCertStore::SaveState(SnapshotWriter& out)
+    {
+        std::vector<const std::string*> certs;
+        for (uint32_t i = 0; i < (1u << CertMerkleTree::DEPTH); i++){
+            for (auto &cert: m_certTree.GetLeaf(i)){
+                certs.push_back(&cert);
             }
         }
+        out.U32(certs.size());
+        for (const std::string* cert: certs){
+            out.Str(*cert);
+        }
+
+        std::vector<std::pair<std::string, std::pair<std::string, int>>> local;
+        for (auto &x: trustRelations){
+            if (x.first == "me" || x.second.first == "me"){
+                local.push_back(x);
+            }
+        }
+        out.U32(local.size());
+        for (auto &x: local){
+            out.Str(x.first);
+            out.Str(x.second.first);
+            out.U32((uint32_t)x.second.second);
+        }
+    }
+
+    bool
+    RIBCertStore::LoadState(SnapshotReader& in)
+    {
+        uint32_t count = in.U32();
+        for (uint32_t i = 0; i < count && in.Ok(); i++){
+            MergeCert(in.Str());
+        }
+        count = in.U32();
+        for (uint32_t i = 0; i < count && in.Ok(); i++){
+            std::string issuer = in.Str();
+            std::string entity = in.Str();
+            int r_transitivity = (int)in.U32();
+            InsertTrust(issuer, entity, r_transitivity);
+        }
+        return in.Ok();
+    }
+
+}
+
+static uint64_t
+CombineDigests(uint64_t left, uint64_t right)
+{
+    // Children are ordered, so mix them asymmetrically (splitmix64 finalizer)
+    uint64_t x = left * 0x9E3779B97F4A7C15ULL + right + 0x632BE59BD9B4E019ULL;
+    x ^= x >> 30;
+    x *= 0xBF58476D1CE4E5B9ULL;
+    x ^= x >> 27;
+    x *= 0x94D049BB133111EBULL;
+    x ^= x >> 31;
+    return x;
+}
+
+CertMerkleTree::CertMerkleTree()
+    : leaves(1u << DEPTH), nodes(2u << DEPTH, 0), count(0)
+{
+    for (uint32_t i = (1u << DEPTH) - 1; i >= 1; i--){
+        nodes[i] = CombineDigests(nodes[2 * i], nodes[2 * i + 1]);
+    }
+}
+
+bool
+CertMerkleTree::Insert(const std::string& cert)
+{
+    uint64_t h = Hash64(cert);
+    uint32_t leaf = h >> (64 - DEPTH);
+    if (!leaves[leaf].insert(cert).second){
+        return false;
+    }
+    count++;
+
+    uint32_t node = (1u << DEPTH) + leaf;
+    nodes[node] += h;
+    for (node >>= 1; node >= 1; node >>= 1){
+        nodes[node] = CombineDigests(nodes[2 * node], nodes[2 * node + 1]);
     }
+    return true;
+}
+
+bool
+CertMerkleTree::Contains(const std::string& cert) const
+{
+    uint32_t leaf = Hash64(cert) >> (64 - DEPTH);
+    return leaves[leaf].count(cert) != 0;
+}
 
-}
\ No newline at end of file
+uint64_t
+CertMerkleTree::GetDigest(uint32_t level, uint32_t index) const
+{
+    return nodes[(1u << level) + index];
+}
+
+const std::set<std::string>&
+CertMerkleTree::GetLeaf(uint32_t index) const
+{
+    return leaves[index];
+}
+
+size_t
+CertMerkleTree::Size() const
+{
+    return count;
+}
@@ -27,6 +27,37 @@ namespace ns3
                             MakeUintegerAccessor(&RIBLinkStateManager::GetPacketWindowSize,
                                                 &RIBLinkStateManager::SetPacketWindowSize),
                             MakeUintegerChecker<uint16_t>(8, 256))
+                .AddAttribute("HeartbeatTimeout",
+                            "Silence after which a switch is taken for dead. Longer tolerates more lost "
+                            "heartbeats (fewer false positives) at the cost of slower failure detection.",
+                            TimeValue(Seconds(3)),
+                            MakeTimeAccessor(&RIBLinkStateManager::m_heartbeatTimeout),
+                            MakeTimeChecker())
+                .AddAttribute("MissedHeartbeats",
+                            "A switch that announced its heartbeat interval is dropped after this many "
+                            "intervals of silence, if that is longer than HeartbeatTimeout.",
+                            UintegerValue(3),
+                            MakeUintegerAccessor(&RIBLinkStateManager::m_missedHeartbeats),
+                            MakeUintegerChecker<uint32_t>(1))
+                .AddAttribute("SweepInterval",
+                            "Time between sweeps for timed-out switches; a failure is detected at most "
+                            "HeartbeatTimeout + SweepInterval after the last heartbeat.",
+                            TimeValue(MilliSeconds(500)),
+                            MakeTimeAccessor(&RIBLinkStateManager::m_sweepInterval),
+                            MakeTimeChecker())
+                .AddAttribute("SubscriptionLease",
+                            "How long a SUBSWITCHES subscription gets membership deltas without being renewed.",
+                            TimeValue(Seconds(30)),
+                            MakeTimeAccessor(&RIBLinkStateManager::m_subscriptionLease),
+                            MakeTimeChecker())
+                .AddTraceSource("SwitchUp",
+                                "A switch was heard from for the first time or again after timing out",
+                                MakeTraceSourceAccessor(&RIBLinkStateManager::m_switchUpTrace),
+                                "ns3::RIBLinkStateManager::SwitchUpCallback")
+                .AddTraceSource("SwitchDown",
+                                "A switch timed out, with the time since its last heartbeat",
+                                MakeTraceSourceAccessor(&RIBLinkStateManager::m_switchDownTrace),
+                                "ns3::RIBLinkStateManager::SwitchDownCallback")
                 .AddTraceSource("Rx",
                                 "A packet has been received",
                                 MakeTraceSourceAccessor(&RIBLinkStateManager::m_rxTrace),
@@ -43,6 +74,10 @@ namespace ns3
     {
         NS_LOG_FUNCTION(this);
         m_received = 0;
+        // * Subscribers start at 0, so even a set restored by LoadState is sent to them
+        m_switchVersion = 1;
+        m_switchListStale = true;
+        m_primaryPeers = MemberList::Encode(0, MemberList::Entries());
         parent_ctx = NULL;
     }
 
@@ -116,6 +151,20 @@ namespace ns3
         }
 
         m_socket6->SetRecvCallback(MakeCallback(&RIBLinkStateManager::HandleRead, this));
+
+        // * Peers restored from a snapshot
+        SharePeers();
+
+        // * Switches restored from a snapshot get one timeout to check in
+        RIB *rib = (RIB *)parent_ctx;
+        for (auto& addr : liveSwitches){
+            std::stringstream ss;
+            ss << addr;
+            if (!rib || rib->shards.Size() == 0 || rib->shards.Owner(ss.str()) == rib->my_addr){
+                m_liveness[addr].lastSeen = Simulator::Now();
+            }
+        }
+        m_sweepEvent = Simulator::Schedule(m_sweepInterval, &RIBLinkStateManager::Sweep, this);
     }
 
     void
@@ -127,6 +176,8 @@ namespace ns3
         {
             m_socket->SetRecvCallback(MakeNullCallback<void, Ptr<Socket>>());
         }
+        Simulator::Cancel(m_sweepEvent);
+        Simulator::Cancel(m_deltaEvent);
     }
 
     void
@@ -147,21 +198,53 @@ namespace ns3
                 std::stringstream ss;
                 packet->CopyData(&ss, packet->GetSize());
                 std::string cmd(ss.str());
-                if (cmd == "GIVEPEERS"){
+                if (cmd.substr(0, 5) == "SHARD"){
+                    HandleShard(cmd);
+                    continue;
+                }
+                if (cmd.substr(0, 11) == "SUBSWITCHES"){
+                    // * Not a heartbeat, clients and other TDs' switches subscribe too
+                    HandleSubscribe(socket, from, cmd);
+                    continue;
+                }
+                bool givePeers = cmd.substr(0, 9) == "GIVEPEERS";
+                if (givePeers){
                     // Switch wants to know what RIBs are adjacent/peering to me.
-                    SendPeers(socket, from);
+                    SendPeers(socket, from, cmd);
                 }
 
                 auto nameOfPeer = InetSocketAddress::ConvertFrom(from).GetIpv4(); // TODO: Change to 256 bit name
-                liveSwitches.insert(nameOfPeer);
+                SwitchLiveness& live = m_liveness[nameOfPeer];
+                live.lastSeen = Simulator::Now();
+                bool up = AddSwitch(nameOfPeer);
+                if (up){
+                    m_switchUpTrace(nameOfPeer);
+                    std::stringstream msg;
+                    msg << "SHARDSWITCH " << nameOfPeer;
+                    ShareWithShards(msg.str());
+                }
 
-                if (cmd == "GIVEPEERS"){
+                if (givePeers){
                     continue;
                 }
 
-                // TODO: Handle timeout
                 SeqTsHeader seqTs;
                 packet->RemoveHeader(seqTs);
+
+                // * Explicit heartbeats announce the interval to the next one (ms)
+                if (packet->GetSize() > 0){
+                    std::stringstream payload;
+                    packet->CopyData(&payload, packet->GetSize());
+                    uint32_t ms = 0;
+                    if (payload >> ms){
+                        live.interval = MilliSeconds(ms);
+                    }
+                }
+                // * A switch we had no (more) is told to heartbeat fast until it is stable again
+                if (up){
+                    std::string reset = "HBRESET";
+                    socket->SendTo(Create<Packet>((const uint8_t *)reset.c_str(), reset.size()), 0, from);
+                }
                 
                 NS_LOG_INFO("Received link state packet: " << seqTs.GetSeq() << " " << seqTs.GetTs());
                 
@@ -199,23 +282,223 @@ namespace ns3
     }
 
     void
-    RIBLinkStateManager::SendPeers(Ptr<Socket> socket, Address addr)
+    RIBLinkStateManager::SendPeers(Ptr<Socket> socket, Address addr, const std::string& request)
     {
         RIB *rib = (RIB *)parent_ctx;
         if (!rib){
             return;
         }
 
-        std::stringstream ss;
-        for (auto &addr: rib->peers){
-            ss << addr.first << " " << Ipv4Address::ConvertFrom(addr.second) << " ";
+        const std::string& list = rib->primary ? m_primaryPeers : rib->peers.GetPeerList();
+        uint32_t since;
+        if (MemberList::ParseSince(request, 9, since) && MemberList::GetVersion(list) <= since){
+            std::string resp = MemberList::NotModified(MemberList::GetVersion(list));
+            socket->SendTo(Create<Packet>((const uint8_t *)resp.data(), resp.size()), 0, addr);
+            return;
         }
 
-        std::string resp(ss.str());
-        NS_LOG_INFO("Sending Peers from LinkStateManager: " << resp);
+        NS_LOG_INFO("Sending Peers from LinkStateManager, version " << MemberList::GetVersion(list));
+        Ptr<Packet> p = Create<Packet>((const uint8_t *)list.data(), list.size());
+        NS_LOG_INFO("Send status: " << socket->SendTo(p, 0, addr));
+    }
+
+    // The binary GIVESWITCHES reply, rebuilt only after liveSwitches changed
+    const std::string&
+    RIBLinkStateManager::GetSwitchList()
+    {
+        // * The version has to cover everything in the set
+        if (!m_switchDelta.empty()){
+            FlushDelta();
+        }
+        if (m_switchListStale){
+            RIB *rib = (RIB *)parent_ctx;
+            MemberList::Entries entries;
+            for (auto& addr : liveSwitches){
+                entries.push_back(std::make_pair(addr, rib ? (uint32_t)rib->td_num : 0));
+            }
+            m_switchList = MemberList::Encode(m_switchVersion, entries);
+            m_switchListStale = false;
+        }
+        return m_switchList;
+    }
 
+    uint32_t
+    RIBLinkStateManager::GetSwitchVersion()
+    {
+        return MemberList::GetVersion(GetSwitchList());
+    }
+
+
+    /* Every packet from a switch is a heartbeat. One periodic sweep drops the
+     * switches silent for longer than their timeout, so GIVESWITCHES stops
+     * handing them out; a dropped switch that heartbeats again is back up.
+     * Switches back off their heartbeat while stable and announce the interval,
+     * the timeout is MissedHeartbeats of it but never below HeartbeatTimeout.
+     * A failure is detected within that timeout plus SweepInterval. */
+    void
+    RIBLinkStateManager::Sweep()
+    {
+        m_sweepEvent = Simulator::Schedule(m_sweepInterval, &RIBLinkStateManager::Sweep, this);
+
+        Time now = Simulator::Now();
+        for (auto it = m_liveness.begin(); it != m_liveness.end();){
+            Time silence = now - it->second.lastSeen;
+            if (silence <= std::max(m_heartbeatTimeout, it->second.interval * (int64_t)m_missedHeartbeats)){
+                ++it;
+                continue;
+            }
+            NS_LOG_INFO("Switch " << it->first << " timed out after " << silence.As(Time::S));
+            RemoveSwitch(it->first);
+            m_switchDownTrace(it->first, silence);
+            std::stringstream msg;
+            msg << "SHARDSWITCHDOWN " << it->first;
+            ShareWithShards(msg.str());
+            it = m_liveness.erase(it);
+        }
+    }
+
+    /* Link state shared between the shards of a TD:
+     *   "SHARDSWITCH <ip>"     a switch heartbeating one shard is live for all
+     *   "SHARDSWITCHDOWN <ip>" and timed out there
+     *   "SHARDPEERS\n<list>"   the primary's binary GIVEPEERS reply, replicas have no peers
+     * Switches heartbeat the shard owning them, so a switch is announced once. */
+    void
+    RIBLinkStateManager::ShareWithShards(const std::string& msg)
+    {
+        RIB *rib = (RIB *)parent_ctx;
+        if (!rib || !m_socket){
+            return;
+        }
+        for (size_t i = 0; i < rib->shards.Size(); i++){
+            if (rib->shards.GetShard(i) == rib->my_addr){
+                continue;
+            }
+            Ptr<Packet> p = Create<Packet>((const uint8_t *)msg.c_str(), msg.size());
+            m_socket->SendTo(p, 0, InetSocketAddress(Ipv4Address::ConvertFrom(rib->shards.GetShard(i)), m_port));
+        }
+    }
+
+    // Called on the primary when its peers change
+    void
+    RIBLinkStateManager::SharePeers()
+    {
+        RIB *rib = (RIB *)parent_ctx;
+        if (!rib || rib->primary || rib->peers.empty()){
+            return;
+        }
+        ShareWithShards("SHARDPEERS\n" + rib->peers.GetPeerList());
+    }
+
+    void
+    RIBLinkStateManager::HandleShard(const std::string& msg)
+    {
+        if (msg.substr(0, 12) == "SHARDSWITCH "){
+            AddSwitch(Ipv4Address(msg.substr(12).c_str()));
+        }
+        else if (msg.substr(0, 16) == "SHARDSWITCHDOWN "){
+            // * Unless it heartbeats us directly, the shard it did is the one that knows
+            Ipv4Address addr(msg.substr(16).c_str());
+            if (m_liveness.find(addr) == m_liveness.end()){
+                RemoveSwitch(addr);
+            }
+        }
+        else if (msg.substr(0, 11) == "SHARDPEERS\n"){
+            m_primaryPeers = msg.substr(11);
+        }
+    }
+
+    /* Switch membership subscriptions. "SUBSWITCHES <version>" subscribes (or
+     * renews, within SubscriptionLease) and names the version the subscriber
+     * holds. A subscriber that is behind gets the whole set,
+     *   "SWITCHES <version> <ip> <ip>...",
+     * and every subscriber gets the changes of each later version,
+     *   "SWDELTA <version> +<ip> -<ip>...".
+     * A subscriber seeing a version gap subscribes again with what it has. */
+    void
+    RIBLinkStateManager::HandleSubscribe(Ptr<Socket> socket, Address from, const std::string& msg)
+    {
+        std::istringstream iss(msg.substr(11));
+        uint32_t version = 0;
+        iss >> version;
+        m_subscribers[from] = Simulator::Now() + m_subscriptionLease;
+        if (version == m_switchVersion && m_switchDelta.empty()){
+            return;
+        }
+
+        std::stringstream ss;
+        ss << "SWITCHES " << m_switchVersion;
+        for (auto& addr : liveSwitches){
+            ss << " " << addr;
+        }
+        // the set already has any pending changes, applying them again with the next delta is harmless
+        std::string resp = ss.str();
         Ptr<Packet> p = Create<Packet>((const uint8_t *)resp.c_str(), resp.size());
-        NS_LOG_INFO("Send status: " << socket->SendTo(p, 0, addr));
+        socket->SendTo(p, 0, from);
+    }
+
+    bool
+    RIBLinkStateManager::AddSwitch(Ipv4Address addr)
+    {
+        if (!liveSwitches.insert(addr).second){
+            return false;
+        }
+        RecordChange(addr, true);
+        return true;
+    }
+
+    bool
+    RIBLinkStateManager::RemoveSwitch(Ipv4Address addr)
+    {
+        if (liveSwitches.erase(addr) == 0){
+            return false;
+        }
+        RecordChange(addr, false);
+        return true;
+    }
+
+    // Changes within one simulator event go out as one delta; a switch that
+    // came and went in between cancels out
+    void
+    RIBLinkStateManager::RecordChange(Ipv4Address addr, bool added)
+    {
+        m_switchListStale = true;
+        auto it = m_switchDelta.find(addr);
+        if (it != m_switchDelta.end() && it->second != added){
+            m_switchDelta.erase(it);
+        }else{
+            m_switchDelta[addr] = added;
+        }
+        if (!m_deltaEvent.IsRunning()){
+            m_deltaEvent = Simulator::ScheduleNow(&RIBLinkStateManager::FlushDelta, this);
+        }
+    }
+
+    void
+    RIBLinkStateManager::FlushDelta()
+    {
+        if (m_switchDelta.empty()){
+            return;
+        }
+        m_switchVersion++;
+        std::stringstream ss;
+        ss << "SWDELTA " << m_switchVersion;
+        for (auto& [addr, added] : m_switchDelta){
+            ss << " " << (added ? "+" : "-") << addr;
+        }
+        m_switchDelta.clear();
+
+        std::string msg = ss.str();
+        Time now = Simulator::Now();
+        for (auto it = m_subscribers.begin(); it != m_subscribers.end();){
+            if (it->second < now){
+                it = m_subscribers.erase(it);
+                continue;
+            }
+            if (m_socket){
+                m_socket->SendTo(Create<Packet>((const uint8_t *)msg.c_str(), msg.size()), 0, it->first);
+            }
+            ++it;
+        }
     }
 
 }
\ No newline at end of file
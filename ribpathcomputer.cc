@@ -27,6 +27,20 @@ namespace ns3
                             MakeUintegerAccessor(&RIBPathComputer::GetPacketWindowSize,
                                                 &RIBPathComputer::SetPacketWindowSize),
                             MakeUintegerChecker<uint16_t>(8, 256))
+                .AddAttribute("CoalesceWindow",
+                            "How long a GIVEPATH query waits for identical queries (same client "
+                            "and DC name) before one path is computed for all of them.",
+                            TimeValue(Seconds(0)),
+                            MakeTimeAccessor(&RIBPathComputer::m_coalesceWindow),
+                            MakeTimeChecker())
+                .AddTraceSource("QueryCoalesced",
+                                "A query joined an identical query that is already being answered",
+                                MakeTraceSourceAccessor(&RIBPathComputer::m_queryCoalescedTrace),
+                                "ns3::QueryFlights::TracedCallback")
+                .AddTraceSource("QueryAnswered",
+                                "A query was answered, with the number of requesters served",
+                                MakeTraceSourceAccessor(&RIBPathComputer::m_queryAnsweredTrace),
+                                "ns3::QueryFlights::TracedCallback")
                 .AddTraceSource("Rx",
                                 "A packet has been received",
                                 MakeTraceSourceAccessor(&RIBPathComputer::m_rxTrace),
@@ -125,6 +139,7 @@ namespace ns3
     RIBPathComputer::StopApplication()
     {
         NS_LOG_FUNCTION(this);
+        Simulator::Cancel(m_revocationEvent);
 
         if (m_socket)
         {
@@ -134,12 +149,163 @@ namespace ns3
 
     
     void
-    RIBPathComputer::SendPath(Ptr<Socket> socket, Address dest, std::string path) 
+    RIBPathComputer::SubmitPath(std::string key, std::string client_name, std::string dc_name)
     {
+        RIB* rib = (RIB *) (this->parent_ctx);
+        if (!rib->serviceQueue->Submit(RIBServiceQueue::OP_GIVEPATH, [this, key, client_name, dc_name]() { AnswerPath(key, client_name, dc_name); })) {
+            m_queryAnsweredTrace(key, m_flights.Complete(key, rib->serviceQueue->GetShedReply(RIBServiceQueue::OP_GIVEPATH)).size());
+        }
+    }
+
+    /* Computes the path once for every client waiting on key and records a
+     * grant per requester so each of them gets revocation notices. */
+    void
+    RIBPathComputer::AnswerPath(std::string key, std::string client_name, std::string dc_name)
+    {
+        RIB* rib = (RIB *) (this->parent_ctx);
+        auto ptr = rib->trustRelations->find(dc_name);
+        size_t colon = dc_name.find(":");
+        if (ptr == rib->trustRelations->end() && colon != std::string::npos) {
+            // * No cert for this exact name: the owner's prefix cert, if any, names the server
+            ptr = rib->trustRelations->find(dc_name.substr(0, colon) + ":*");
+        }
+        if (ptr == rib->trustRelations->end()) {
+            NS_LOG_WARN("Unable to find the destination DC name in RIB");
+            m_queryAnsweredTrace(key, m_flights.Complete(key, nullptr).size());
+            return;
+        }
+        std::string dc_server_ip = ptr->second.first;
+        std::vector<std::string> hops = GetPathHops(client_name, dc_server_ip);
+
+        std::string path = "";
+        for (auto& hop : hops) {
+            path.append(hop + ",");
+        }
+        if (path.size() == 0) {
+            path.append(",");
+        }
+
         std::string str_repr = "path:" + path;
         NS_LOG_INFO("path to send: " << str_repr);
         Ptr<Packet> p = Create<Packet>((const uint8_t *)str_repr.c_str(), str_repr.size());
-        NS_LOG_INFO("Send to client " << socket->SendTo(p, 0, dest));
+        std::vector<Address> requesters = m_flights.Complete(key, p);
+        if (!hops.empty()) {
+            for (auto& client : requesters) {
+                RecordPathGrant(client, client_name, dc_name, dc_server_ip, hops);
+            }
+        }
+        m_queryAnsweredTrace(key, requesters.size());
+    }
+
+    void
+    RIBPathComputer::RecordPathGrant(Address client, std::string client_name, std::string dc_name, std::string dc_server, std::vector<std::string>& hops)
+    {
+        auto key = std::make_pair(client, dc_name);
+        DropPathGrant(key);
+
+        path_grants[key] = PathGrant{client, client_name, dc_name, dc_server, hops};
+        for (auto &hop: hops){
+            node_subscribers[hop].insert(key);
+        }
+    }
+
+    void
+    RIBPathComputer::DropPathGrant(std::pair<Address, std::string> key)
+    {
+        auto it = path_grants.find(key);
+        if (it == path_grants.end()){
+            return;
+        }
+
+        for (auto &hop: it->second.hops){
+            auto sub = node_subscribers.find(hop);
+            if (sub == node_subscribers.end()){
+                continue;
+            }
+            sub->second.erase(key);
+            if (sub->second.empty()){
+                node_subscribers.erase(sub);
+            }
+        }
+        path_grants.erase(it);
+    }
+
+    void
+    RIBPathComputer::SendPathInvalidation(const PathGrant& grant)
+    {
+        // Packet format: "pathinval:<dc server ip> <dc name>"
+        std::string str_repr = "pathinval:" + grant.dc_server + " " + grant.dc_name;
+        NS_LOG_INFO("Invalidating path of " << grant.client_name << " to " << grant.dc_server);
+        Ptr<Packet> p = Create<Packet>((const uint8_t *)str_repr.c_str(), str_repr.size());
+        NS_LOG_INFO("Send to client " << m_socket->SendTo(p, 0, grant.client));
+    }
+
+    void
+    RIBPathComputer::NotifyRevocation()
+    {
+        // Don't wait for the periodic recalculation; clients should stop using
+        // a revoked path as soon as the distrust reaches us.
+        if (!m_revocationEvent.IsRunning()){
+            m_revocationEvent = Simulator::ScheduleNow(&RIBPathComputer::RebuildGraph, this);
+        }
+    }
+
+    /* An ad-derived edge went away with the last ad that implied it: drop it from
+     * the graph in place and re-check the grants that go through either end. */
+    void
+    RIBPathComputer::NotifyEdgeRemoved(const std::string& issuer, const std::string& entity)
+    {
+        RIB *rib = (RIB *)parent_ctx;
+        std::string s1 = isItMe(issuer) ? "me" : issuer;
+        std::string s2 = isItMe(entity) ? "me" : entity;
+
+        auto it1 = trust_graph.nodes_to_id.find(s1);
+        auto it2 = trust_graph.nodes_to_id.find(s2);
+        if (it1 == trust_graph.nodes_to_id.end() || it2 == trust_graph.nodes_to_id.end()){
+            return;
+        }
+        int id1 = it1->second;
+        int id2 = it2->second;
+
+        auto [range_start, range_stop] = trust_graph.trust_edges.equal_range(id1);
+        for (auto it = range_start; it != range_stop; ++it){
+            if (it->second == id2){
+                trust_graph.trust_edges.erase(it);
+                break;
+            }
+        }
+        trust_graph.transitivity.erase({id1, id2});
+
+        // A relation still implying this edge (e.g. another alias of "me") puts it back on rebuild
+        revoked_nodes.insert(s1 == "me" ? "AS" + std::to_string(rib->td_num) : s1);
+        revoked_nodes.insert(s2 == "me" ? "AS" + std::to_string(rib->td_num) : s2);
+        NotifyRevocation();
+    }
+
+    void
+    RIBPathComputer::CheckPathGrants()
+    {
+        std::set<std::pair<Address, std::string>> affected;
+        for (auto &node: revoked_nodes){
+            auto it = node_subscribers.find(node);
+            if (it != node_subscribers.end()){
+                affected.insert(it->second.begin(), it->second.end());
+            }
+        }
+        revoked_nodes.clear();
+
+        for (auto &key: affected){
+            auto it = path_grants.find(key);
+            if (it == path_grants.end()){
+                continue;
+            }
+            // Still the path we would hand out now, nothing to tell the client
+            if (GetPathHops(it->second.client_name, it->second.dc_server) == it->second.hops){
+                continue;
+            }
+            SendPathInvalidation(it->second);
+            DropPathGrant(key);
+        }
     }
     
 
@@ -173,39 +339,14 @@ namespace ns3
                     }
                     std::string client_name = root["client_name"].asString();
                     std::string dc_name = root["dc_name"].asString();
-        
 
-                    
-                    RIB* rib = (RIB *) (this->parent_ctx);
-                    auto ptr = rib->trustRelations->find(dc_name);
-                    if (ptr == rib->trustRelations->end()) {
-                        NS_LOG_WARN("Unable to find the destination DC name in RIB");
+                    // * Identical requests share one computation and one reply packet
+                    std::string key = "GIVEPATH " + client_name + " " + dc_name;
+                    if (!m_flights.Join(key, socket, from)) {
+                        m_queryCoalescedTrace(key, m_flights.GetWaiting(key));
                         continue;
                     }
-                    std::string dc_server_ip = ptr->second.first;
-                    std::vector<std::string> path_vec = GetPath(client_name, dc_server_ip);
-            
-                    std::string path = "";
-                    for (auto& ip : path_vec) {
-                        if (ip == "me") {
-                            int as_number = global_addr_to_AS.at(rib->my_addr);
-                            ip = "AS" + std::to_string(as_number);
-                        }
-                        if (ip.find("AS") != std::string::npos) {
-                            path.append(ip + ",");
-                        }
-                    }
-
-                    // * add the destination ip into the path
-                    if (path.size() == 0) 
-                        path.append(",");
-                    else
-                        path.append(path_vec[path_vec.size()-1]+",");
-                    // path = path.substr(0, path.size()-1); // trim the last ","
-
-     
-                    // * Send the path to the client
-                    Simulator::ScheduleNow(&RIBPathComputer::SendPath, this, socket, from, path);
+                    Simulator::Schedule(m_coalesceWindow, &RIBPathComputer::SubmitPath, this, key, client_name, dc_name);
                     
                 }                
 
@@ -257,6 +398,13 @@ namespace ns3
         ss2 << Ipv4Address::ConvertFrom(rib->my_addr);
         if (entity == ss2.str()) return true;
 
+        // Clients pledge to the shard they are homed on, any shard of the TD is me
+        for (size_t i = 0; i < rib->shards.Size(); i++){
+            std::stringstream ss3;
+            ss3 << Ipv4Address::ConvertFrom(rib->shards.GetShard(i));
+            if (entity == ss3.str()) return true;
+        }
+
         return false;
 
     }
@@ -265,7 +413,12 @@ namespace ns3
     RIBPathComputer::ComputeGraph()
     {
         Simulator::Schedule(Seconds(1.0), &RIBPathComputer::ComputeGraph, this);
+        RebuildGraph();
+    }
 
+    void
+    RIBPathComputer::RebuildGraph()
+    {
         if (!parent_ctx){
             NS_LOG_INFO("No RIB");
             return;
@@ -342,6 +495,7 @@ namespace ns3
             auto it2 = trust_graph.distrust_edges.find({id1, id2});
             if (it2 == trust_graph.distrust_edges.end()){
                 trust_graph.distrust_edges.insert({id1, id2});
+                revoked_nodes.insert(s2 == "me" ? "AS" + std::to_string(rib->td_num) : s2);
             }
         }
 
@@ -364,6 +518,8 @@ namespace ns3
         }
 
         trust_graph.FloydWarshall();
+        CheckPathGrants();
+
         if (trust_graph.nodes_to_id.find("user:1") != trust_graph.nodes_to_id.end()){
             auto path = GetPath("user:1", "AS9");
             std::stringstream ss;
@@ -375,6 +531,31 @@ namespace ns3
         }
     }
 
+    // Path as handed out to clients: the TDs to traverse ("me" resolved to my AS number)
+    // followed by the DC server. Empty if there is no trusted path through any TD.
+    std::vector<std::string>
+    RIBPathComputer::GetPathHops(std::string client_name, std::string dc_server)
+    {
+        std::vector<std::string> hops;
+        std::vector<std::string> path_vec = GetPath(client_name, dc_server);
+        RIB *rib = (RIB *)(this->parent_ctx);
+
+        for (auto& ip : path_vec) {
+            if (ip == "me") {
+                int as_number = global_addr_to_AS.at(rib->my_addr);
+                ip = "AS" + std::to_string(as_number);
+            }
+            if (ip.find("AS") != std::string::npos) {
+                hops.push_back(ip);
+            }
+        }
+
+        if (hops.size() != 0) {
+            hops.push_back(path_vec[path_vec.size()-1]);
+        }
+        return hops;
+    }
+
     std::vector<std::string>
     RIBPathComputer::GetPath(std::string startNode, std::string endNode)
     {
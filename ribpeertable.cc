@@ -0,0 +1,128 @@
+#include "main.h"
+
+RIBPeerTable::RIBPeerTable()
+{
+    peer_list_stale = true;
+    version = 0;
+}
+
+bool
+RIBPeerTable::Add(int as_num, const Address& addr)
+{
+    Peer* existing = Find(as_num);
+    if (existing)
+    {
+        if (existing->addr == addr)
+        {
+            return false;
+        }
+        slot_of_addr.erase(Ipv4Address::ConvertFrom(existing->addr));
+        existing->addr = addr;
+        slot_of_addr[Ipv4Address::ConvertFrom(addr)] = slot_of_as[as_num];
+    }
+    else
+    {
+        Peer peer;
+        peer.as_num = as_num;
+        peer.addr = addr;
+        auto pos = peers.begin();
+        while (pos != peers.end() && pos->as_num < as_num)
+        {
+            ++pos;
+        }
+        peers.insert(pos, std::move(peer));
+        Reindex();
+    }
+    peer_list_stale = true;
+    version++;
+    return true;
+}
+
+bool
+RIBPeerTable::Remove(int as_num)
+{
+    Peer* peer = Find(as_num);
+    if (!peer)
+    {
+        return false;
+    }
+    Simulator::Cancel(peer->flushEvent);
+    peers.erase(peers.begin() + slot_of_as[as_num]);
+    Reindex();
+    peer_list_stale = true;
+    version++;
+    return true;
+}
+
+void
+RIBPeerTable::Reindex()
+{
+    slot_of_as.clear();
+    slot_of_addr.clear();
+    for (size_t i = 0; i < peers.size(); i++)
+    {
+        int as_num = peers[i].as_num;
+        if (as_num >= 0)
+        {
+            if ((size_t)as_num >= slot_of_as.size())
+            {
+                slot_of_as.resize(as_num + 1, -1);
+            }
+            slot_of_as[as_num] = i;
+        }
+        slot_of_addr[Ipv4Address::ConvertFrom(peers[i].addr)] = i;
+    }
+}
+
+RIBPeerTable::Peer*
+RIBPeerTable::Find(int as_num)
+{
+    if (as_num < 0 || (size_t)as_num >= slot_of_as.size() || slot_of_as[as_num] < 0)
+    {
+        return nullptr;
+    }
+    return &peers[slot_of_as[as_num]];
+}
+
+RIBPeerTable::Peer*
+RIBPeerTable::Find(const Ipv4Address& addr)
+{
+    auto it = slot_of_addr.find(addr);
+    return it == slot_of_addr.end() ? nullptr : &peers[it->second];
+}
+
+RIBPeerTable::Peer*
+RIBPeerTable::Find(const Address& addr)
+{
+    if (InetSocketAddress::IsMatchingType(addr))
+    {
+        return Find(InetSocketAddress::ConvertFrom(addr).GetIpv4());
+    }
+    if (Ipv4Address::IsMatchingType(addr))
+    {
+        return Find(Ipv4Address::ConvertFrom(addr));
+    }
+    return nullptr;
+}
+
+const std::string&
+RIBPeerTable::GetPeerList()
+{
+    if (peer_list_stale)
+    {
+        MemberList::Entries entries;
+        for (auto& peer : peers)
+        {
+            entries.push_back(std::make_pair(Ipv4Address::ConvertFrom(peer.addr), (uint32_t)peer.as_num));
+        }
+        peer_list = MemberList::Encode(version, entries);
+        peer_list_stale = false;
+    }
+    return peer_list;
+}
+
+uint32_t
+RIBPeerTable::GetVersion() const
+{
+    return version;
+}
@@ -0,0 +1,63 @@
+#include "main.h"
+
+namespace ns3
+{
+
+    bool
+    QueryFlights::Join(const std::string& key, Ptr<Socket> socket, Address dest)
+    {
+        auto& waiters = m_waiting[key];
+        waiters.push_back(std::make_pair(socket, dest));
+        return waiters.size() == 1;
+    }
+
+    uint32_t
+    QueryFlights::GetWaiting(const std::string& key) const
+    {
+        auto it = m_waiting.find(key);
+        if (it == m_waiting.end()){
+            return 0;
+        }
+        return it->second.size();
+    }
+
+    std::vector<Address>
+    QueryFlights::Complete(const std::string& key, Ptr<Packet> response)
+    {
+        std::vector<Address> requesters;
+        auto it = m_waiting.find(key);
+        if (it == m_waiting.end()){
+            return requesters;
+        }
+
+        for (auto &x: it->second){
+            requesters.push_back(x.second);
+            if (response){
+                // Copy() shares the serialized buffer, nothing is re-encoded per requester
+                x.first->SendTo(response->Copy(), 0, x.second);
+            }
+        }
+        m_waiting.erase(it);
+        return requesters;
+    }
+
+    std::vector<Address>
+    QueryFlights::Complete(const std::string& key, const std::vector<Ptr<Packet>>& responses)
+    {
+        std::vector<Address> requesters;
+        auto it = m_waiting.find(key);
+        if (it == m_waiting.end()){
+            return requesters;
+        }
+
+        for (auto &x: it->second){
+            requesters.push_back(x.second);
+            for (auto &response: responses){
+                x.first->SendTo(response->Copy(), 0, x.second);
+            }
+        }
+        m_waiting.erase(it);
+        return requesters;
+    }
+
+}
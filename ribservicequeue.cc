@@ -0,0 +1,215 @@
+#include "main.h"
+#include <chrono>
+
+namespace ns3
+{
+
+    NS_LOG_COMPONENT_DEFINE("RIBServiceQueue");
+
+    NS_OBJECT_ENSURE_REGISTERED(RIBServiceQueue);
+
+    TypeId
+    RIBServiceQueue::GetTypeId()
+    {
+        static TypeId tid =
+            TypeId("ns3::RIBServiceQueue")
+                .SetParent<Object>()
+                .SetGroupName("Applications")
+                .AddConstructor<RIBServiceQueue>()
+                .AddAttribute("Cores",
+                            "Number of requests the RIB can serve concurrently.",
+                            UintegerValue(1),
+                            MakeUintegerAccessor(&RIBServiceQueue::m_cores),
+                            MakeUintegerChecker<uint32_t>(1))
+                .AddAttribute("MaxQueueDepth",
+                            "Client queries waiting beyond this depth are shed. 0 means unbounded.",
+                            UintegerValue(0),
+                            MakeUintegerAccessor(&RIBServiceQueue::m_maxQueueDepth),
+                            MakeUintegerChecker<uint32_t>())
+                .AddAttribute("ShedMode",
+                            "Whether a shed request is silently dropped or answered with a NACK.",
+                            EnumValue(RIBServiceQueue::SHED_NACK),
+                            MakeEnumAccessor(&RIBServiceQueue::m_shedMode),
+                            MakeEnumChecker(RIBServiceQueue::SHED_DROP, "Drop",
+                                            RIBServiceQueue::SHED_NACK, "Nack"))
+                .AddAttribute("GiveSwitchesCost",
+                            "Service time of a GIVESWITCHES query.",
+                            TimeValue(Seconds(0)),
+                            MakeTimeAccessor(&RIBServiceQueue::m_giveSwitchesCost),
+                            MakeTimeChecker())
+                .AddAttribute("GiveAdsCost",
+                            "Service time of a GIVEADS query.",
+                            TimeValue(Seconds(0)),
+                            MakeTimeAccessor(&RIBServiceQueue::m_giveAdsCost),
+                            MakeTimeChecker())
+                .AddAttribute("GivePathCost",
+                            "Service time of a GIVEPATH query.",
+                            TimeValue(Seconds(0)),
+                            MakeTimeAccessor(&RIBServiceQueue::m_givePathCost),
+                            MakeTimeChecker())
+                .AddAttribute("AdCost",
+                            "Service time of processing one received advertisement.",
+                            TimeValue(Seconds(0)),
+                            MakeTimeAccessor(&RIBServiceQueue::m_adCost),
+                            MakeTimeChecker())
+                .AddAttribute("CertCost",
+                            "Service time of processing one received certificate.",
+                            TimeValue(Seconds(0)),
+                            MakeTimeAccessor(&RIBServiceQueue::m_certCost),
+                            MakeTimeChecker())
+                .AddAttribute("AntiEntropyCost",
+                            "Service time of one anti-entropy sync or leaf message.",
+                            TimeValue(Seconds(0)),
+                            MakeTimeAccessor(&RIBServiceQueue::m_antiEntropyCost),
+                            MakeTimeChecker())
+                .AddAttribute("Calibrate",
+                            "Use the measured wall-clock cost of each opcode (times CalibrationScale) "
+                            "instead of the configured cost once a measurement exists.",
+                            BooleanValue(false),
+                            MakeBooleanAccessor(&RIBServiceQueue::m_calibrate),
+                            MakeBooleanChecker())
+                .AddAttribute("CalibrationScale",
+                            "Factor applied to measured wall-clock cost, to model a slower or faster RIB host.",
+                            DoubleValue(1.0),
+                            MakeDoubleAccessor(&RIBServiceQueue::m_calibrationScale),
+                            MakeDoubleChecker<double>(0.0))
+                .AddAttribute("CalibrationWeight",
+                            "Weight of the newest sample in the moving average of measured cost.",
+                            DoubleValue(0.125),
+                            MakeDoubleAccessor(&RIBServiceQueue::m_calibrationWeight),
+                            MakeDoubleChecker<double>(0.0, 1.0))
+                .AddTraceSource("Served",
+                                "A request started running, with the time it spent queued",
+                                MakeTraceSourceAccessor(&RIBServiceQueue::m_servedTrace),
+                                "ns3::RIBServiceQueue::ServedCallback")
+                .AddTraceSource("Shed",
+                                "A request was shed because the queue was full",
+                                MakeTraceSourceAccessor(&RIBServiceQueue::m_shedTrace),
+                                "ns3::RIBServiceQueue::ShedCallback");
+        return tid;
+    }
+
+    RIBServiceQueue::RIBServiceQueue()
+    {
+        NS_LOG_FUNCTION(this);
+        m_busy = 0;
+        for (uint32_t i = 0; i < OP_COUNT; i++){
+            m_measured[i] = -1;
+        }
+    }
+
+    RIBServiceQueue::~RIBServiceQueue()
+    {
+        NS_LOG_FUNCTION(this);
+    }
+
+    std::string
+    RIBServiceQueue::GetOpcodeName(Opcode op)
+    {
+        switch (op){
+            case OP_GIVESWITCHES: return "GIVESWITCHES";
+            case OP_GIVEADS: return "GIVEADS";
+            case OP_GIVEPATH: return "GIVEPATH";
+            case OP_AD: return "AD";
+            case OP_CERT: return "CERT";
+            case OP_ANTIENTROPY: return "ANTIENTROPY";
+            default: return "UNKNOWN";
+        }
+    }
+
+    Time
+    RIBServiceQueue::GetCost(Opcode op) const
+    {
+        if (m_calibrate && m_measured[op] >= 0){
+            return Seconds(m_measured[op] * m_calibrationScale);
+        }
+        switch (op){
+            case OP_GIVESWITCHES: return m_giveSwitchesCost;
+            case OP_GIVEADS: return m_giveAdsCost;
+            case OP_GIVEPATH: return m_givePathCost;
+            case OP_AD: return m_adCost;
+            case OP_CERT: return m_certCost;
+            case OP_ANTIENTROPY: return m_antiEntropyCost;
+            default: return Seconds(0);
+        }
+    }
+
+    uint32_t
+    RIBServiceQueue::GetQueueDepth() const
+    {
+        return m_queue.size();
+    }
+
+    Ptr<Packet>
+    RIBServiceQueue::GetShedReply(Opcode op) const
+    {
+        if (m_shedMode == SHED_DROP){
+            return nullptr;
+        }
+        std::string nack = "NACK:" + GetOpcodeName(op);
+        return Create<Packet>((const uint8_t *)nack.c_str(), nack.size());
+    }
+
+    // Clients re-query, but a flooded ad or cert is sent once: losing it would
+    // leave the RIBs inconsistent, so those only wait
+    bool
+    RIBServiceQueue::IsSheddable(Opcode op)
+    {
+        return op == OP_GIVESWITCHES || op == OP_GIVEADS || op == OP_GIVEPATH;
+    }
+
+    bool
+    RIBServiceQueue::Submit(Opcode op, std::function<void()> work)
+    {
+        Job job{op, work, Simulator::Now()};
+
+        // * Nothing to model: keep the old zero-time behaviour
+        if (m_queue.empty() && m_busy < m_cores && GetCost(op).IsZero()){
+            m_servedTrace(op, Seconds(0));
+            RunJob(job);
+            return true;
+        }
+
+        if (m_maxQueueDepth != 0 && IsSheddable(op) && m_busy >= m_cores && m_queue.size() >= m_maxQueueDepth){
+            NS_LOG_INFO("Shedding " << GetOpcodeName(op) << ", queue depth " << m_queue.size());
+            m_shedTrace(op, m_queue.size());
+            return false;
+        }
+
+        m_queue.push_back(job);
+        StartJobs();
+        return true;
+    }
+
+    void
+    RIBServiceQueue::StartJobs()
+    {
+        while (m_busy < m_cores && !m_queue.empty()){
+            Job job = m_queue.front();
+            m_queue.pop_front();
+            m_busy++;
+            m_servedTrace(job.op, Simulator::Now() - job.enqueued);
+            Simulator::Schedule(GetCost(job.op), &RIBServiceQueue::FinishJob, this, job);
+        }
+    }
+
+    void
+    RIBServiceQueue::FinishJob(Job job)
+    {
+        m_busy--;
+        RunJob(job);
+        StartJobs();
+    }
+
+    void
+    RIBServiceQueue::RunJob(Job& job)
+    {
+        auto start = std::chrono::steady_clock::now();
+        job.work();
+        double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        double& avg = m_measured[job.op];
+        avg = avg < 0 ? elapsed : (m_calibrationWeight * elapsed + (1 - m_calibrationWeight) * avg);
+    }
+
+}
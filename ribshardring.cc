@@ -0,0 +1,54 @@
+#include "main.h"
+
+void
+RIBShardRing::AddShard(const Address& addr)
+{
+    uint32_t index = shards.size();
+    shards.push_back(addr);
+
+    std::stringstream ss;
+    ss << Ipv4Address::ConvertFrom(addr);
+    for (uint32_t v = 0; v < VNODES; v++)
+    {
+        ring[Hash64(ss.str() + "#" + std::to_string(v))] = index;
+    }
+}
+
+size_t
+RIBShardRing::Size() const
+{
+    return shards.size();
+}
+
+const Address&
+RIBShardRing::GetShard(uint32_t index) const
+{
+    return shards[index];
+}
+
+uint32_t
+RIBShardRing::OwnerIndex(const std::string& key) const
+{
+    if (shards.size() <= 1)
+    {
+        return 0;
+    }
+    auto it = ring.lower_bound(Hash64(key));
+    if (it == ring.end())
+    {
+        it = ring.begin();
+    }
+    return it->second;
+}
+
+const Address&
+RIBShardRing::Owner(const std::string& key) const
+{
+    return shards[OwnerIndex(key)];
+}
+
+bool
+RIBShardRing::Contains(const Address& addr) const
+{
+    return std::find(shards.begin(), shards.end(), addr) != shards.end();
+}
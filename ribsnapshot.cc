@@ -0,0 +1,181 @@
+#include "main.h"
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+NS_LOG_COMPONENT_DEFINE("RIBSnapshot");
+
+void
+SnapshotWriter::U8(uint8_t v)
+{
+    data.push_back((char)v);
+}
+
+void
+SnapshotWriter::U32(uint32_t v)
+{
+    for (int i = 0; i < 4; i++)
+    {
+        data.push_back((char)((v >> (8 * i)) & 0xff));
+    }
+}
+
+void
+SnapshotWriter::U64(uint64_t v)
+{
+    U32((uint32_t)v);
+    U32((uint32_t)(v >> 32));
+}
+
+void
+SnapshotWriter::Bytes(const uint8_t* bytes, uint32_t len)
+{
+    U32(len);
+    data.append((const char*)bytes, len);
+}
+
+SnapshotReader::SnapshotReader(const uint8_t* bytes, size_t size)
+{
+    pos = bytes;
+    end = bytes + size;
+    ok = true;
+}
+
+const uint8_t*
+SnapshotReader::Take(size_t n)
+{
+    if (!ok || (size_t)(end - pos) < n)
+    {
+        ok = false;
+        return nullptr;
+    }
+    const uint8_t* start = pos;
+    pos += n;
+    return start;
+}
+
+uint8_t
+SnapshotReader::U8()
+{
+    const uint8_t* p = Take(1);
+    return p ? p[0] : 0;
+}
+
+uint32_t
+SnapshotReader::U32()
+{
+    const uint8_t* p = Take(4);
+    if (!p)
+    {
+        return 0;
+    }
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+uint64_t
+SnapshotReader::U64()
+{
+    uint64_t low = U32();
+    uint64_t high = U32();
+    return low | (high << 32);
+}
+
+const uint8_t*
+SnapshotReader::Bytes(uint32_t& len)
+{
+    len = U32();
+    return Take(len);
+}
+
+std::string
+SnapshotReader::Str()
+{
+    uint32_t len;
+    const uint8_t* p = Bytes(len);
+    return p ? std::string((const char*)p, len) : std::string();
+}
+
+/* File layout:
+ *   u32 magic | u32 version | u64 topology | u32 #ribs | RIB::SaveState of each RIB */
+bool
+SaveRIBSnapshot(const std::string& path, const std::vector<RIB *>& ribs, uint64_t topology)
+{
+    SnapshotWriter out;
+    out.U32(RIB_SNAPSHOT_MAGIC);
+    out.U32(RIB_SNAPSHOT_VERSION);
+    out.U64(topology);
+    out.U32(ribs.size());
+    for (RIB* rib : ribs)
+    {
+        rib->SaveState(out);
+    }
+
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    file.write(out.Data().data(), out.Data().size());
+    if (!file)
+    {
+        NS_LOG_ERROR("Cannot write RIB snapshot " << path);
+        return false;
+    }
+    NS_LOG_INFO("Saved " << ribs.size() << " RIBs (" << out.Data().size() << " bytes) to " << path
+                << " at " << Simulator::Now().As(Time::S));
+    return true;
+}
+
+// A snapshot that does not match this run is refused untouched; one that is
+// cut short after the RIBs started loading is fatal.
+bool
+LoadRIBSnapshot(const std::string& path, const std::vector<RIB *>& ribs, uint64_t topology)
+{
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+    {
+        NS_LOG_ERROR("Cannot open RIB snapshot " << path);
+        return false;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size == 0)
+    {
+        close(fd);
+        NS_LOG_ERROR("Cannot read RIB snapshot " << path);
+        return false;
+    }
+    void* mapping = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (mapping == MAP_FAILED)
+    {
+        NS_LOG_ERROR("Cannot map RIB snapshot " << path);
+        return false;
+    }
+
+    SnapshotReader in((const uint8_t*)mapping, st.st_size);
+    bool loaded = false;
+    if (in.U32() != RIB_SNAPSHOT_MAGIC)
+    {
+        NS_LOG_ERROR(path << " is not a RIB snapshot");
+    }
+    else if (in.U32() != RIB_SNAPSHOT_VERSION)
+    {
+        NS_LOG_ERROR(path << " is a snapshot of another version");
+    }
+    else if (in.U64() != topology || in.U32() != ribs.size())
+    {
+        NS_LOG_ERROR(path << " is a snapshot of another topology");
+    }
+    else
+    {
+        for (RIB* rib : ribs)
+        {
+            if (!rib->LoadState(in))
+            {
+                NS_FATAL_ERROR("Corrupt RIB snapshot " << path << " at AS" << rib->td_num);
+            }
+        }
+        loaded = true;
+        NS_LOG_INFO("Loaded " << ribs.size() << " RIBs from " << path);
+    }
+
+    munmap(mapping, st.st_size);
+    return loaded;
+}
@@ -190,15 +190,16 @@ RIBTraceRoute::StopApplication()
         if (parent_ctx && all_as.size() == 2){
             for (auto &as: all_as){
                 if (as != parent_ctx->td_num){
-                    parent_ctx->peers[as] = m_remote;
+                    if (parent_ctx->peers.Add(as, m_remote)){
+                        parent_ctx->linkManager->SharePeers();
+                    }
 
 
 
 
                     std::stringstream asstr;
                     asstr << "AS" << as;
-                    parent_ctx->trustRelations->insert(std::make_pair(std::string("me"),
-                        std::make_pair(asstr.str(), INT_MAX)));
+                    parent_ctx->certStore->InsertTrust("me", asstr.str(), INT_MAX);
                     // setup global mapping between ASes and their addresses
                     global_addr_to_AS[m_remote] = as;
                     global_AS_to_addr[as] = m_remote;
@@ -0,0 +1,91 @@
+#include "main.h"
+#include <algorithm>
+#include <iterator>
+
+SwitchMembership::SwitchMembership()
+    : version(0)
+{
+}
+
+bool
+SwitchMembership::IsPush(const std::string& msg)
+{
+    return msg.substr(0, 9) == "SWITCHES " || msg.substr(0, 8) == "SWDELTA ";
+}
+
+bool
+SwitchMembership::Apply(const std::string& msg, std::vector<Ipv4Address>& added, std::vector<Ipv4Address>& removed)
+{
+    std::istringstream iss(msg);
+    std::string kind;
+    uint32_t v;
+    if (!(iss >> kind >> v))
+    {
+        return true;
+    }
+
+    std::string token;
+    if (kind == "SWITCHES")
+    {
+        // a reordered, older set
+        if (v < version)
+        {
+            return true;
+        }
+        std::set<Ipv4Address> latest;
+        while (iss >> token)
+        {
+            latest.insert(Ipv4Address(token.c_str()));
+        }
+        std::set_difference(latest.begin(), latest.end(), switches.begin(), switches.end(), std::back_inserter(added));
+        std::set_difference(switches.begin(), switches.end(), latest.begin(), latest.end(), std::back_inserter(removed));
+        switches.swap(latest);
+        version = v;
+        return true;
+    }
+
+    if (v <= version)
+    {
+        return true;
+    }
+    if (v != version + 1)
+    {
+        return false;
+    }
+    while (iss >> token)
+    {
+        if (token.size() < 2)
+        {
+            continue;
+        }
+        Ipv4Address addr(token.substr(1).c_str());
+        if (token[0] == '+' && switches.insert(addr).second)
+        {
+            added.push_back(addr);
+        }
+        else if (token[0] == '-' && switches.erase(addr) > 0)
+        {
+            removed.push_back(addr);
+        }
+    }
+    version = v;
+    return true;
+}
+
+std::string
+SwitchMembership::SubscribeRequest() const
+{
+    return "SUBSWITCHES " + std::to_string(version);
+}
+
+uint32_t
+SwitchMembership::GetVersion() const
+{
+    return version;
+}
+
+const std::set<Ipv4Address>&
+SwitchMembership::GetSwitches() const
+{
+    return switches;
+}